@@ -6,6 +6,8 @@
 * 3. GPGSA
 * 4. GPGST
 * 5. GPGLL
+* The "GP" talker ID may be any other, such as GN, GL, GA, GB or GQ from multi-GNSS
+* receivers; the sentence is decoded the same way and tagged with its talker.
 * 
 *
 * NMEA Sentence formats:
@@ -20,35 +22,88 @@
 *
 * $GPGLL,x.x,N,x.x,W,hhmmss,A/V,*cs
 * where x is a number, hh - hours, mm - minutes, ss - seconds and cs - checksum(in hex)
+* cs is the XOR of all characters between '$' and '*' and is verified for every sentence.
 *
 * Examples:
 *
-* $GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,,*47
+* $GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,,*6B
 *
-* $GPGSV,2,1,08,01,40,083,46,02,17,308,41,12,07,344,39,14,22,228,45,*75
+* $GPGSV,2,1,08,01,40,083,46,02,17,308,41,12,07,344,39,14,22,228,45,*59
 *
-* $GPGSA,A,3,04,05,,09,12,,,24,,,,,2.5,1.3,2.1,*39
+* $GPGSA,A,3,04,05,,09,12,,,24,,,,,2.5,1.3,2.1,*15
 *
-* $GPGST,172814,0.006,0.023,0.020,273.6,0.023,0.020,0.031,*6A
+* $GPGST,172814,0.006,0.023,0.020,273.6,0.023,0.020,0.031,*58
 *
-* $GPGLL,4916.45,N,12311.12,W,225444,A,*34
+* $GPGLL,4916.45,N,12311.12,W,225444,A,*1D
 *
 * 
 *
 * File: NMEAparser.c
-* Compilation: gcc NMEAparser.c
-* Input is read from a file "message.txt"
+* Library interface: NMEAparser.h
+* Compilation: gcc -O2 -pthread NMEAparser.c
+* Input is read from the file named on the command line, "message.txt" by default.
+* Usage: a.out [-m | -s | -r slots | -p stages | -j threads] [file] | -l source...
+*   -m maps the file and parses it in place, -s frames a live byte stream ('-' is
+*   stdin), -r does the same with reading on its own thread feeding a lock-free
+*   ring, -p runs framing, validation, decoding and output as a pipeline of pinned
+*   threads, -j parses the mapped file in chunks on a pool of threads.
+*   -l source... reads many receivers at once with epoll: paths, '-', unix:path and
+*   tcp:port listeners, tagging every sentence with the ID of its stream.
+*   -b runs a benchmark over the file instead (-b scan: structural scan in GB/s,
+*   -b fused: separate and fused line checking passes in time per sentence,
+*   -b throughput: end-to-end rates per input mode and sentence type,
+*   -b stages: CSV of time and hardware counters per sentence for each stage).
+*   -g writes a synthetic corpus for the benchmarks to stdout.
+*   -a prefix writes the decoded sentences to one Arrow IPC file per sentence type
+*   instead of printing them, -n sets the rows per record batch.
+*   -i interval writes a sidecar time index file.idx during the parse, and -t from,to
+*   uses it to parse only the sentences of that time range; without an index, -t
+*   binary searches the mapped file for the start of the range instead.
+*   -k reports every complete GSV cycle as one sky view instead of its messages.
+*   -e timeout merges the GGA, GSA, GST and GLL of each epoch into one fix report.
+*   -o csv|ndjson writes the sentences, fixes and sky views as CSV rows under one
+*   header for all types, or as JSON objects, instead of the text report. All output goes through a 64 KB buffer written with write(2).
+*
+* The parsers decode into the result structures declared in NMEAparser.h and
+* return a status code; the Print* functions and the NMEASink formatters turn
+* those results into the human-readable report written by main.
 *
 *
 ===============================================================================*/
 
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
 #include<stdio.h>
 #include<string.h>
 #include<stdlib.h>
 #include<ctype.h>
-
-#define MAX_INPUT_LINE_LENGTH 200
+#include<stdint.h>
+#include<stdarg.h>
+#if defined(__SSE2__) || defined(__AVX2__) || defined(__x86_64__)
+#include<immintrin.h>
+#define NMEA_HAVE_X86_SIMD 1
+#endif
+#include<errno.h>
+#include<fcntl.h>
+#include<unistd.h>
+#include<time.h>
+#include<pthread.h>
+#include<sched.h>
+#include<signal.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<sys/socket.h>
+#include<sys/un.h>
+#include<netinet/in.h>
+#ifdef __linux__
+#include<sys/epoll.h>
+#include<sys/ioctl.h>
+#include<sys/syscall.h>
+#include<linux/perf_event.h>
+#endif
+#include "NMEAparser.h"
 
 /**
  * checkdigit
@@ -57,15 +112,16 @@
  * <p> 
  * 
  * @param  input Buffer containing the input string
+ * @param  len Number of characters to check
  * @param  x specifies whether the input is a float or integer value.
  * @return value -1 if input is not a number else 0.
  */
 
-int checkdigit(char* input, int x) {
-	int i=0;
+int checkdigit(const char* input, unsigned int len, int x) {
+	unsigned int i=0;
 	if(x==0){
-		while(input[i]!='\0'){	
-			if(!isdigit(input[i])){
+		while(i<len){	
+			if(!isdigit((unsigned char)input[i])){
 				return -1;	
 			}
 			i++;
@@ -73,8 +129,8 @@ int checkdigit(char* input, int x) {
 	}
 	else {
 		int countDot=0;
-		while(input[i]!='\0'){	
-			if(!isdigit(input[i])){
+		while(i<len){	
+			if(!isdigit((unsigned char)input[i])){
 				if((input[i] == '.') && (countDot==0)){
 					countDot++;	
 				}
@@ -87,1911 +143,6382 @@ int checkdigit(char* input, int x) {
 	return 0;
 }
 
+/*
+ * Checksum kernels. The NMEA checksum is the XOR of every byte between '$' and '*',
+ * so the body can be folded 32 or 16 bytes at a time into a vector accumulator and the
+ * lanes XORed together at the end. NMEAChecksum picks the widest kernel the CPU supports.
+ */
 
-/**
- *  GPGGAparser                          
- * <p>
- * This function is used for parsing GPGGA format sentences.
- * <p> 
- * 
- * @param  buf Buffer containing the input string read from the file
- * @param  bufsize Size of the input Buffer
- */
-
-void GPGGAParser(char *buf, unsigned int bufSize)
-{
-	char auxBuf[20];
-	char* p2;
-	char* p3;
-	unsigned int index=7;
-	printf("\n\n**********Parsing GPGGA input string**********\n\n");
-	// GGA
-	buf+=7;
-	// Time
-	if(index>=bufSize)
-	{
-		printf("End of string");
-		
-		return;
+static unsigned char FoldXor64(uint64_t acc) {
+	acc ^= acc >> 32;
+	acc ^= acc >> 16;
+	acc ^= acc >> 8;
+	return (unsigned char)acc;
+}
+
+static unsigned char XorScalar(const unsigned char *p, size_t n, uint64_t acc) {
+	uint64_t w;
+	while(n >= 8) {
+		memcpy(&w, p, 8);
+		acc ^= w;
+		p += 8;
+		n -= 8;
 	}
-	if((p2=strchr(buf,','))==NULL) {
-		
-		printf("Wrong format\n");
-		return;
+	unsigned char x = FoldXor64(acc);
+	while(n-- > 0)
+		x ^= *p++;
+	return x;
+}
+
+#ifdef NMEA_HAVE_X86_SIMD
+static unsigned char XorSSE2(const unsigned char *p, size_t n) {
+	__m128i acc = _mm_setzero_si128();
+	uint64_t lanes[2];
+	while(n >= 16) {
+		acc = _mm_xor_si128(acc, _mm_loadu_si128((const __m128i *)p));
+		p += 16;
+		n -= 16;
 	}
-	else {
-		if(p2-buf==0) {
-			printf("Fix time not specified\n");
-			buf++;
-			index++;
-		}
-		else if (p2-buf!=6) {
-			printf("Incorrect time format\n");
-			return;
-		}
-		else {
-			
-			index+=(p2-buf+1);
-			printf("Fix taken at ");
-			strncpy(auxBuf, buf, 2);
-			auxBuf[2] = '\0';
-			int hour = atoi(auxBuf);
-			if (hour>23) {
-				printf("Wrong value of time. Hour cannot be greater than 23");
-				return;
-			}
-			buf += 2;
-			printf("%s:",auxBuf);
-			strncpy(auxBuf, buf, 2);
-			auxBuf[2] = '\0';
-			buf += 2;
-			int min = atoi(auxBuf);
-			if (min>59) {
-				printf("Wrong value of time. Minutes cannot be greater than 59");
-				
-				return;
-			}
-			printf("%s:",auxBuf);
-			strncpy(auxBuf, buf, 2);
-			auxBuf[2] = '\0';
-			buf = p2 + 1;
-			int sec = atoi(auxBuf);
-			if (sec>59) {
-				printf("Wrong value of time. Seconds cannot be greater than 59");
-				
-				return;
-			}
-			printf("%s UTC\n",auxBuf);
+	_mm_storeu_si128((__m128i *)lanes, acc);
+	return XorScalar(p, n, lanes[0] ^ lanes[1]);
+}
+
+__attribute__((target("avx2")))
+static unsigned char XorAVX2(const unsigned char *p, size_t n) {
+	__m256i acc = _mm256_setzero_si256();
+	__m128i half;
+	uint64_t lanes[2];
+	while(n >= 32) {
+		acc = _mm256_xor_si256(acc, _mm256_loadu_si256((const __m256i *)p));
+		p += 32;
+		n -= 32;
+	}
+	half = _mm_xor_si128(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+	if(n >= 16) {
+		half = _mm_xor_si128(half, _mm_loadu_si128((const __m128i *)p));
+		p += 16;
+		n -= 16;
+	}
+	_mm_storeu_si128((__m128i *)lanes, half);
+	return XorScalar(p, n, lanes[0] ^ lanes[1]);
+}
+#endif
+
+/**
+ * NMEAChecksum
+ * <p>
+ * This function computes the XOR of len bytes starting at buf.
+ * <p>
+ *
+ * @param  buf Start of the sentence body (the character after '$')
+ * @param  len Number of bytes up to, but not including, the '*'
+ * @return XOR of all the bytes
+ */
+unsigned char NMEAChecksum(const char *buf, size_t len) {
+#ifdef NMEA_HAVE_X86_SIMD
+	if(__builtin_cpu_supports("avx2"))
+		return XorAVX2((const unsigned char *)buf, len);
+	return XorSSE2((const unsigned char *)buf, len);
+#else
+	return XorScalar((const unsigned char *)buf, len, 0);
+#endif
+}
+
+static int HexValue(char c) {
+	if(c >= '0' && c <= '9')
+		return c - '0';
+	if(c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	if(c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	return -1;
+}
+
+static NMEAStatus CompareChecksum(const char *sentence, size_t len, const char *star) {
+	int hi, lo;
+	if(star == NULL)
+		return NMEA_ERR_NO_TERMINATOR;
+	if(sentence + len - star != 3)
+		return NMEA_ERR_CHECKSUM;
+	if((hi = HexValue(star[1])) < 0 || (lo = HexValue(star[2])) < 0)
+		return NMEA_ERR_CHECKSUM;
+	if(NMEAChecksum(sentence + 1, star - sentence - 1) != (hi << 4 | lo))
+		return NMEA_ERR_CHECKSUM;
+	return NMEA_OK;
+}
+
+/**
+ * NMEAVerifyChecksum
+ * <p>
+ * This function compares the two hex digits after '*' with the XOR of the sentence body.
+ * <p>
+ *
+ * @param  sentence Sanitized sentence starting with '$'
+ * @param  len Length of the sentence
+ * @return NMEA_OK if the checksum matches, NMEA_ERR_NO_TERMINATOR if there is no '*',
+ *         NMEA_ERR_CHECKSUM if the digits are missing or do not match
+ */
+NMEAStatus NMEAVerifyChecksum(const char *sentence, size_t len) {
+	if(len >= 4 && sentence[len-3] == '*')
+		return CompareChecksum(sentence, len, sentence + len - 3);
+	return CompareChecksum(sentence, len, memchr(sentence, '*', len));
+}
+
+/*
+ * Structural scan. Every 64-byte block is classified into one bitmask per structural
+ * character, bit i standing for byte i of the block. Field and sentence boundaries are
+ * then found by walking the set bits with count-trailing-zeros instead of byte by byte.
+ * The AVX2 and SSE2 kernels compare 32 or 16 bytes per instruction; the portable kernel
+ * builds the same masks one byte at a time.
+ */
+
+static void ScanScalar(const char *p, NMEAStructMasks *m) {
+	int i;
+	memset(m, 0, sizeof(*m));
+	for(i=0;i<64;i++) {
+		uint64_t bit = (uint64_t)1 << i;
+		switch(p[i]) {
+			case ',':
+				m->comma |= bit;
+				break;
+			case '*':
+				m->star |= bit;
+				break;
+			case '$':
+				m->dollar |= bit;
+				break;
+			case '\r':
+				m->cr |= bit;
+				break;
+			case '\n':
+				m->lf |= bit;
+				break;
 		}
 	}
-	
-	// Latitude
-	if(index>=bufSize)
-	{
-		printf("End of string");
-		
-		return;
+}
+
+#ifdef NMEA_HAVE_X86_SIMD
+static uint64_t MatchSSE2(const __m128i v[4], char c) {
+	__m128i k = _mm_set1_epi8(c);
+	return (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v[0], k))
+		| (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v[1], k)) << 16
+		| (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v[2], k)) << 32
+		| (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v[3], k)) << 48;
+}
+
+static void ScanSSE2(const char *p, NMEAStructMasks *m) {
+	__m128i v[4];
+	v[0] = _mm_loadu_si128((const __m128i *)p);
+	v[1] = _mm_loadu_si128((const __m128i *)(p + 16));
+	v[2] = _mm_loadu_si128((const __m128i *)(p + 32));
+	v[3] = _mm_loadu_si128((const __m128i *)(p + 48));
+	m->comma = MatchSSE2(v, ',');
+	m->star = MatchSSE2(v, '*');
+	m->dollar = MatchSSE2(v, '$');
+	m->cr = MatchSSE2(v, '\r');
+	m->lf = MatchSSE2(v, '\n');
+}
+
+__attribute__((target("avx2")))
+static inline uint64_t MatchAVX2(__m256i lo, __m256i hi, char c) {
+	__m256i k = _mm256_set1_epi8(c);
+	return (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, k))
+		| (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, k)) << 32;
+}
+
+__attribute__((target("avx2")))
+static void ScanAVX2(const char *p, NMEAStructMasks *m) {
+	__m256i lo = _mm256_loadu_si256((const __m256i *)p);
+	__m256i hi = _mm256_loadu_si256((const __m256i *)(p + 32));
+	m->comma = MatchAVX2(lo, hi, ',');
+	m->star = MatchAVX2(lo, hi, '*');
+	m->dollar = MatchAVX2(lo, hi, '$');
+	m->cr = MatchAVX2(lo, hi, '\r');
+	m->lf = MatchAVX2(lo, hi, '\n');
+}
+#endif
+
+typedef void (*StructScanFn)(const char *p, NMEAStructMasks *m);
+
+static StructScanFn SelectScanKernel(void) {
+	static StructScanFn kernel;
+	StructScanFn k = __atomic_load_n(&kernel, __ATOMIC_RELAXED);
+	if(k == NULL) {
+#ifdef NMEA_HAVE_X86_SIMD
+		k = __builtin_cpu_supports("avx2") ? ScanAVX2 : ScanSSE2;
+#else
+		k = ScanScalar;
+#endif
+		__atomic_store_n(&kernel, k, __ATOMIC_RELAXED);
 	}
-	if((p2=strchr(buf,','))==NULL) {	
-		printf("Wrong format\n");
-		
-		return;
+	return k;
+}
+
+/**
+ * NMEAStructuralScan
+ * <p>
+ * This function classifies up to 64 bytes into structural bitmasks using the widest
+ * kernel the CPU supports. Bytes past len are treated as ordinary characters.
+ * <p>
+ *
+ * @param  p Start of the block
+ * @param  len Bytes available from p; 64 or more scans a full block without copying
+ * @param  m Receives the bitmasks
+ */
+void NMEAStructuralScan(const char *p, size_t len, NMEAStructMasks *m) {
+	char pad[64];
+	if(len < 64) {
+		memcpy(pad, p, len);
+		memset(pad + len, 0, 64 - len);
+		p = pad;
 	}
-	else {
-		if(p2-buf==0) {
-			printf("Latitude not specified\n");
-			buf++;
-			index++;
-			p3=strchr(buf,',');	
-			if(p3-buf==0) {
-				buf++;
-				index++;
-			}
-			else {
-				buf=buf+3;
-				index+=3;
-			}
-		}
-		else {
-			index+=(p2-buf+1);
-			strncpy(auxBuf, buf, p2 - buf);
-			auxBuf[p2 - buf] = '\0';
-			buf = p2 + 1;
-			if((p2 = strchr(auxBuf, '.')) == NULL) {
-				printf("Incorrect format\n");
-				return;
-			}
-			if(p2-auxBuf < 2) {
-				return;
-			}
-			int latitude = atoi(auxBuf);
-			if (latitude/100>90 || latitude/100<0) {
-				printf("Wrong value of latitude. Latitude measurements range from 0B0 to 90B0.");
-				return;
-			}
-			int min = latitude%100;
-			if (min>59) {
-				printf("Wrong value of latitude. Minutes cannot be greater than 59");
-				return;
-			}
-			printf("latitude: %d deg %d%s' ", latitude/100,min,p2);
-			if((p2 = strchr(buf, ',')) == NULL)
-				printf("Wrong format");
-			if(p2 - buf != 1) {
-				printf("\nNot valid GPGGA sentence format, direction missing\n");
-				return;
+	SelectScanKernel()(p, m);
+}
+
+/**
+ * NMEATokenize
+ * <p>
+ * This function splits a sentence into fields in a single pass over its structural
+ * bitmasks. Field 0 is the address ("GPGGA"), the data fields follow. Scanning stops at the '*'; a sentence without one
+ * has its last field running to the end of the buffer. Fields beyond NMEA_MAX_FIELDS are
+ * not recorded, which no supported sentence type accepts anyway.
+ * <p>
+ *
+ * @param  buf Buffer containing a sentence starting with '$'
+ * @param  len Length of the sentence
+ * @param  f Table receiving the offset and length of every field
+ */
+void NMEATokenize(const char *buf, unsigned int len, NMEAFields *f) {
+	unsigned int base, begin=1;
+	f->count = 0;
+	f->star = -1;
+	for(base=0;base<len;base+=64) {
+		NMEAStructMasks m;
+		uint64_t sep;
+		NMEAStructuralScan(buf + base, len - base, &m);
+		sep = m.comma | m.star;
+		if(base == 0)
+			sep &= ~(uint64_t)1;
+		while(sep != 0) {
+			unsigned int bit = __builtin_ctzll(sep);
+			unsigned int i = base + bit;
+			sep &= sep - 1;
+			if(f->count < NMEA_MAX_FIELDS) {
+				f->start[f->count] = begin;
+				f->len[f->count++] = i - begin;
 			}
-			if(*buf == 'S')
-				printf("S\n");
-			else if(*buf == 'N')
-				printf("N\n");
-			else {
-				printf("Wrong direction. Possible values 'N' or 'S'");
+			begin = i + 1;
+			if(m.star & ((uint64_t)1 << bit)) {
+				f->star = i;
 				return;
 			}
-			index+=(p2-buf+1);
-			buf = p2 + 1;
 		}
 	}
-	
-	// Longitude
-	if(index>=bufSize)
-	{
-		printf("End of string");
-		return;
+	if(f->count < NMEA_MAX_FIELDS && len > 0) {
+		f->start[f->count] = begin;
+		f->len[f->count++] = len - begin;
 	}
-	if((p2=strchr(buf,','))==NULL) {	
-		printf("Wrong format\n");
-		return;
+}
+
+/*
+ * Field decoders. They work directly on a field's bytes inside the sentence buffer and
+ * never copy it, so there is no length limit beyond the integer range checks.
+ */
+
+/* Field k was followed by a ',' and so is not the last field of the sentence. */
+#define FIELD_AVAILABLE(f,k) ((k)+1 < (f)->count)
+
+/* End of the last field, which bounds what the decoders may read past a field's end */
+#define FIELDS_END(buf,f) ((buf) + (f)->start[(f)->count-1] + (f)->len[(f)->count-1])
+
+static NMEAStatus DecodeInt(const char *p, unsigned int len, int max, int *out) {
+	unsigned int i;
+	int v=0;
+	if(checkdigit(p, len, 0)<0)
+		return NMEA_ERR_NOT_NUMBER;
+	for(i=0;i<len;i++) {
+		if(v > max)
+			return NMEA_ERR_RANGE;
+		v = v*10 + (p[i]-'0');
 	}
-	else {
-		if(p2-buf==0) {
-			printf("Latitude not specified\n");
-			buf++;
-			index++;
-			p3=strchr(buf,',');	
-			if(p3-buf==0) {
-				buf++;
-				index++;
-			}
-			else {
-				buf=buf+3;
-				index+=3;
-			}
+	if(v > max)
+		return NMEA_ERR_RANGE;
+	*out = v;
+	return NMEA_OK;
+}
+
+static const uint64_t powersOf10[] = {
+	1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull, 10000000ull, 100000000ull,
+	1000000000ull, 10000000000ull, 100000000000ull, 1000000000000ull, 10000000000000ull,
+	100000000000000ull, 1000000000000000ull
+};
+
+/*
+ * Decimal number to a fixed-point integer with 'scale' fraction digits. The result is
+ * the exact value rounded half up, which only needs the first digit dropped.
+ */
+static NMEAStatus DecodeFixed(const char *p, unsigned int len, unsigned int scale, int32_t max, int32_t *out) {
+	unsigned int i, frac=0;
+	uint64_t v=0;
+	int dot=0, roundUp=0;
+	if(checkdigit(p, len, 1)<0)
+		return NMEA_ERR_NOT_NUMBER;
+	for(i=0;i<len;i++) {
+		if(p[i] == '.') {
+			dot = 1;
+			continue;
 		}
-		else {
-			index+=(p2-buf+1);
-			strncpy(auxBuf, buf, p2 - buf);
-			auxBuf[p2 - buf] = '\0';
-			buf = p2 + 1;
-			if((p2 = strchr(auxBuf, '.')) == NULL) {
-				printf("Incorrect format\n");
-				return;
-			}
-			if(p2-auxBuf < 2)
-				return;
-			int longitude = atoi(auxBuf);
-			if (longitude/100>180 || longitude/100<0) {
-				printf("Wrong value of longitude. Longitude measurements range from 0B0 to 180B0.");
-				return;
-			}
-			int min = longitude%100;
-			if (min>59) {
-				printf("Wrong value of longitude. Minutes cannot be greater than 59");
-				return;
-			}
-			printf("longitude: %d deg %d%s' ", longitude/100,min%100,p2);
-			if((p2 = strchr(buf, ',')) == NULL)
-				printf("Wrong format");
-			if(p2 - buf != 1) {
-				printf("\nNot valid GPGGA sentence format, direction missing\n");
-				return;
-			}
-			if(*buf == 'E')
-				printf("E\n");
-			else if(*buf == 'W')
-				printf("W\n");
-			else {
-				printf("Wrong direction. Possible values 'E' or 'W'");
-				return;
-			}
-			index+=(p2-buf+1);
-			buf = p2 + 1;
+		if(dot && frac == scale) {
+			roundUp = p[i] >= '5';
+			break;
 		}
+		v = v*10 + (p[i]-'0');
+		if(v > (uint64_t)max)
+			return NMEA_ERR_RANGE;
+		frac += dot;
 	}
-	
-	// GPS quality
-	if(index>=bufSize)
-	{
-		printf("End of string");
-		return;
+	v = v*powersOf10[scale-frac] + roundUp;
+	if(v > (uint64_t)max)
+		return NMEA_ERR_RANGE;
+	*out = v;
+	return NMEA_OK;
+}
+
+/* Little-endian loads, so the first character is always the lowest byte */
+static inline uint64_t Load64LE(const char *p) {
+	uint64_t v;
+	memcpy(&v, p, 8);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	v = __builtin_bswap64(v);
+#endif
+	return v;
+}
+
+static inline uint32_t Load32LE(const char *p) {
+	uint32_t v;
+	memcpy(&v, p, 4);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	v = __builtin_bswap32(v);
+#endif
+	return v;
+}
+
+/* Nonzero if any byte of w is not an ASCII digit */
+#define SWAR_NOT_DIGITS(w,ones) (((w) | ((w) + 0x46*(ones)) | ((w) - 0x30*(ones))) & 0x80*(ones))
+
+/*
+ * hhmmss[.s[s[s]]] to milliseconds of the day. The six time digits are checked and
+ * combined in one 64-bit word and the fraction in one 32-bit word, so a fractional
+ * time costs the same as a whole one. The words are loaded straight from the field
+ * when 'end' leaves room for them, otherwise from a zero-padded copy. Fraction digits
+ * past milliseconds must still be digits but are dropped.
+ */
+static NMEAStatus DecodeTime(const char *p, unsigned int len, const char *end, uint32_t *ms) {
+	const uint64_t ones64 = 0x0101010101010101ull;
+	const uint32_t ones32 = 0x01010101u;
+	const uint64_t timeMask = 0x0000FFFFFFFFFFFFull;
+	char pad[12];
+	uint64_t digits, pairs;
+	uint32_t frac = 0x30303030u, hour, min, sec;
+	if(len != 6 && (len < 8 || p[6] != '.'))
+		return NMEA_ERR_TIME_FORMAT;
+	if(len > 10 && checkdigit(p + 10, len - 10, 0)<0)
+		return NMEA_ERR_NOT_NUMBER;
+	if(end - p < 12) {
+		memset(pad, 0, sizeof(pad));
+		memcpy(pad, p, len < sizeof(pad) ? len : sizeof(pad));
+		p = pad;
 	}
-	if((p2=strchr(buf,','))==NULL) {	
-		printf("Wrong format\n");
-		return;
+	digits = (Load64LE(p) & timeMask) | (0x3030303030303030ull & ~timeMask);
+	if(len > 6) {
+		unsigned int fracLen = len - 7 < 3 ? len - 7 : 3;
+		uint32_t fracMask = (1u << (8*fracLen)) - 1;
+		frac = (Load32LE(p + 7) & fracMask) | (0x30303030u & ~fracMask);
 	}
-	else {
-		if(p2-buf==0) {
-			printf("Fix Quality not specified\n");
-			buf++;
-			index++;
-		}
-		else {
-			index+=(p2-buf+1);
-			strncpy(auxBuf, buf, p2 - buf);
-			auxBuf[p2 - buf] = '\0';
-			buf = p2 + 1;
-			if (checkdigit(auxBuf,0)<0) {
-				printf("Fix Quality must be a number");
-				return;
-			}
-			int q;
-			q=atoi(auxBuf);
-			if (q==0)
-				printf("Quality of fix: 'Invalid Fix'\n");
-			else if (q == 1)
-				printf("Quality of fix: 'GPS Fix'\n");
-			else if (q==2)
-				printf("Quality of fix: 'DGPS Fix'\n");
-			else {
-				printf("Wrong value of Quality of fix specified'\n");
-				return;
-			}
+	if(SWAR_NOT_DIGITS(digits, ones64) | SWAR_NOT_DIGITS(frac, ones32))
+		return NMEA_ERR_NOT_NUMBER;
+	digits -= 0x30*ones64;
+	frac -= 0x30*ones32;
+	// Adjacent digits to two-digit numbers: bytes 0, 2 and 4 hold hours, minutes, seconds
+	pairs = (digits*10 + (digits >> 8)) & 0x000000FF00FF00FFull;
+	hour = pairs & 0xFF;
+	min = (pairs >> 16) & 0xFF;
+	sec = (pairs >> 32) & 0xFF;
+	if((hour > 23) | (min > 59) | (sec > 59))
+		return NMEA_ERR_RANGE;
+	*ms = ((hour*60 + min)*60 + sec)*1000 + (frac & 0xFF)*100 + ((frac >> 8) & 0xFF)*10 + ((frac >> 16) & 0xFF);
+	return NMEA_OK;
+}
 
-		}
+/* Most minute fraction digits used; digits after these cannot change the rounded result */
+#define COORD_MAX_FRACTION 15
+
+/*
+ * (d)ddmm.mmm followed by a one letter hemisphere field, to signed 1e-7 degrees and the
+ * hemisphere letter, which keeps the side of a zero coordinate. The minutes m/10^k are
+ * converted exactly: m/10^k/60 degrees is m*10^(6-k)/6 units of 1e-7 degrees, rounded
+ * half up in magnitude. Because the divisor is even, dropping fraction digits past
+ * COORD_MAX_FRACTION never moves the result across a half.
+ */
+static NMEAStatus DecodeCoord(const char *p, unsigned int len, const char *dir, unsigned int dirLen,
+		int maxDeg, char pos, char neg, int32_t *c, char *hemisphere) {
+	const char *dot;
+	uint64_t minutes, num, den;
+	unsigned int i, k=0;
+	int deg;
+	if(checkdigit(p, len, 1)<0)
+		return NMEA_ERR_NOT_NUMBER;
+	if((dot = memchr(p, '.', len)) == NULL || dot-p < 2)
+		return NMEA_ERR_FORMAT;
+	if(DecodeInt(p, dot-p-2, maxDeg, &deg) != NMEA_OK)
+		return NMEA_ERR_RANGE;
+	minutes = (dot[-2]-'0')*10 + (dot[-1]-'0');
+	if(minutes>59)
+		return NMEA_ERR_RANGE;
+	for(i=dot-p+1;i<len && k<COORD_MAX_FRACTION;i++,k++)
+		minutes = minutes*10 + (p[i]-'0');
+	if(dirLen != 1 || (*dir != pos && *dir != neg))
+		return NMEA_ERR_DIRECTION;
+	if(k <= 6) {
+		num = minutes*powersOf10[6-k];
+		den = 6;
 	}
-	
-	// Satellites in use
-	if(index>=bufSize)
-	{
-		printf("End of string");
-		return;
+	else {
+		num = minutes;
+		den = 6*powersOf10[k-6];
 	}
-	if((p2=strchr(buf,','))==NULL) {	
-		printf("Wrong format\n");
-		return;
+	*c = deg*10000000 + (int32_t)((num + den/2) / den);
+	if(*dir == neg)
+		*c = -*c;
+	*hemisphere = *dir;
+	return NMEA_OK;
+}
+
+/* After the last data field k-1 the sentence must end with an empty field and the '*' */
+static NMEAStatus CheckTerminator(const NMEAFields *f, unsigned int k) {
+	if(f->count != k+1 || f->len[k] != 0 || f->star < 0)
+		return NMEA_ERR_NO_TERMINATOR;
+	return NMEA_OK;
+}
+
+/* Small integer code; values outside min..max are invalid rather than out of range */
+static NMEAStatus DecodeCode(const char *p, unsigned int len, int min, int max, int *out) {
+	NMEAStatus status = DecodeInt(p, len, max, out);
+	if(status == NMEA_ERR_RANGE || (status == NMEA_OK && *out < min))
+		return NMEA_ERR_INVALID_VALUE;
+	return status;
+}
+
+/* One of two status letters, taken from the first character of the field */
+static NMEAStatus DecodeChar(const char *p, char a, char b, char *out) {
+	*out = *p;
+	if(*out != a && *out != b)
+		return NMEA_ERR_INVALID_VALUE;
+	return NMEA_OK;
+}
+
+/* Fixed-point value followed by a one letter unit field */
+static NMEAStatus DecodeUnit(const char *p, unsigned int len, const char *unit, unsigned int unitLen,
+		unsigned int scale, char expect, int32_t *out) {
+	NMEAStatus status;
+	if((status = DecodeFixed(p, len, scale, INT32_MAX, out)) != NMEA_OK)
+		return status;
+	if(unitLen != 1 || *unit != expect)
+		return NMEA_ERR_UNIT;
+	return NMEA_OK;
+}
+
+/* Hundredths of a degree. Whole degrees must be below 360; 359.995 and up round to 360.00, which is 0 */
+static NMEAStatus DecodeHeading(const char *p, unsigned int len, int32_t *out) {
+	const char *dot = memchr(p, '.', len);
+	NMEAStatus status;
+	int deg;
+	if((status = DecodeFixed(p, len, 2, INT32_MAX, out)) != NMEA_OK)
+		return status;
+	if(DecodeInt(p, dot != NULL ? (unsigned int)(dot-p) : len, 359, &deg) != NMEA_OK)
+		return NMEA_ERR_RANGE;
+	if(*out == 36000)
+		*out = 0;
+	return NMEA_OK;
+}
+
+/*
+ * Sentence schemas. Each lists the logical fields of a sentence type in order, field i
+ * owning bit i of the valid mask, as F##_KIND(member, column name, bit, arguments):
+ *
+ *   TIME                    hhmmss.sss, to milliseconds of the day
+ *   COORD maxDeg, pos, neg  (d)ddmm.mmm and a hemisphere field, to 1e-7 degrees, the
+ *                           hemisphere letter going to member##Dir
+ *   INT max                 integer 0..max
+ *   CODE min, max           integer code, NMEA_ERR_INVALID_VALUE outside min..max
+ *   COUNT max               integer 0..max that may not be empty
+ *   FIXED scale             decimal with 'scale' fraction digits
+ *   UNIT scale, unit        decimal followed by a one letter unit field
+ *   CHAR a, b               one of two status letters
+ *   HEADING                 degrees below 360, in hundredths
+ *
+ * The decoders, SentenceValues, NMEASentenceTime and the column tables are all expanded
+ * from these, one per entry of NMEA_SENTENCE_TYPES.
+ */
+#define GGA_SCHEMA(F) \
+	F##_TIME(time, "time", NMEA_GGA_TIME) \
+	F##_COORD(lat, "latitude_e7", NMEA_GGA_LAT, 90, 'N', 'S') \
+	F##_COORD(lon, "longitude_e7", NMEA_GGA_LON, 180, 'E', 'W') \
+	F##_CODE(quality, "quality", NMEA_GGA_QUALITY, 0, 2) \
+	F##_INT(satellites, "satellites", NMEA_GGA_SATS, 12) \
+	F##_FIXED(hdop, "hdop_x100", NMEA_GGA_HDOP, 2) \
+	F##_UNIT(altitude, "altitude_mm", NMEA_GGA_ALT, 3, 'M') \
+	F##_UNIT(geoidHeight, "geoid_height_mm", NMEA_GGA_GEOID, 3, 'M') \
+	F##_INT(dgpsAge, "dgps_age", NMEA_GGA_DGPS_AGE, 999999) \
+	F##_INT(dgpsStation, "dgps_station", NMEA_GGA_DGPS_STATION, 9999)
+
+#define GSA_PRN(F,i,n) F##_INT(prn[i], "prn_" #n, NMEA_GSA_PRN(i), 99999)
+
+#define GSA_SCHEMA(F) \
+	F##_CHAR(mode, "mode", NMEA_GSA_MODE, 'A', 'M') \
+	F##_CODE(fixType, "fix_type", NMEA_GSA_FIX, 1, 3) \
+	GSA_PRN(F,0,1) GSA_PRN(F,1,2) GSA_PRN(F,2,3) GSA_PRN(F,3,4) \
+	GSA_PRN(F,4,5) GSA_PRN(F,5,6) GSA_PRN(F,6,7) GSA_PRN(F,7,8) \
+	GSA_PRN(F,8,9) GSA_PRN(F,9,10) GSA_PRN(F,10,11) GSA_PRN(F,11,12) \
+	F##_FIXED(pdop, "pdop_x100", NMEA_GSA_PDOP, 2) \
+	F##_FIXED(hdop, "hdop_x100", NMEA_GSA_HDOP, 2) \
+	F##_FIXED(vdop, "vdop_x100", NMEA_GSA_VDOP, 2)
+
+#define GLL_SCHEMA(F) \
+	F##_COORD(lat, "latitude_e7", NMEA_GLL_LAT, 90, 'N', 'S') \
+	F##_COORD(lon, "longitude_e7", NMEA_GLL_LON, 180, 'E', 'W') \
+	F##_TIME(time, "time", NMEA_GLL_TIME) \
+	F##_CHAR(status, "status", NMEA_GLL_STATUS, 'A', 'V')
+
+#define GSV_SATELLITE(F,i,n) \
+	F##_INT(sv[i].prn, "sv" #n "_prn", NMEA_GSV_SV(i,0), 99999) \
+	F##_INT(sv[i].elevation, "sv" #n "_elevation", NMEA_GSV_SV(i,1), 90) \
+	F##_INT(sv[i].azimuth, "sv" #n "_azimuth", NMEA_GSV_SV(i,2), 359) \
+	F##_INT(sv[i].snr, "sv" #n "_snr", NMEA_GSV_SV(i,3), 99)
+
+#define GSV_SCHEMA(F) \
+	F##_COUNT(totalMessages, "total_messages", NMEA_GSV_TOTAL, 9) \
+	F##_COUNT(messageNumber, "message_number", NMEA_GSV_MSGNUM, 9) \
+	F##_INT(satellitesInView, "satellites_in_view", NMEA_GSV_INVIEW, 12) \
+	GSV_SATELLITE(F,0,1) GSV_SATELLITE(F,1,2) GSV_SATELLITE(F,2,3) GSV_SATELLITE(F,3,4)
+
+#define GST_SCHEMA(F) \
+	F##_TIME(time, "time", NMEA_GST_TIME) \
+	F##_FIXED(rms, "rms_mm", NMEA_GST_RMS, 3) \
+	F##_FIXED(semiMajor, "semi_major_mm", NMEA_GST_SEMI_MAJOR, 3) \
+	F##_FIXED(semiMinor, "semi_minor_mm", NMEA_GST_SEMI_MINOR, 3) \
+	F##_HEADING(orientation, "orientation_x100", NMEA_GST_ORIENTATION) \
+	F##_FIXED(sigmaLat, "sigma_lat_mm", NMEA_GST_SIGMA_LAT, 3) \
+	F##_FIXED(sigmaLon, "sigma_lon_mm", NMEA_GST_SIGMA_LON, 3) \
+	F##_FIXED(sigmaAlt, "sigma_alt_mm", NMEA_GST_SIGMA_ALT, 3)
+
+/*
+ * Decoder steps, one per schema entry, expanded inline into a straight-line decoder.
+ * Each checks that its field (and the unit or hemisphere field after it) was followed
+ * by a ',', decodes it unless it is empty and sets its validity bit. 'buf', 'f', 'k',
+ * 'status' and 'out' are the generated decoder's.
+ */
+#define FIELD_BYTES(k) buf+f->start[k], f->len[k]
+
+#define DECODE_STEP(width, bit, decode) \
+	if(!FIELD_AVAILABLE(f,k+(width)-1)) \
+		return NMEA_ERR_FORMAT; \
+	if(f->len[k]) { \
+		if((status = decode) != NMEA_OK) \
+			return status; \
+		out->valid |= (bit); \
+	} \
+	out->fieldsRead++; \
+	k += (width);
+
+#define DECODE_TIME(m,name,bit) \
+	DECODE_STEP(1, bit, DecodeTime(FIELD_BYTES(k), FIELDS_END(buf,f), &out->m))
+#define DECODE_COORD(m,name,bit,maxDeg,pos,neg) \
+	DECODE_STEP(2, bit, DecodeCoord(FIELD_BYTES(k), FIELD_BYTES(k+1), maxDeg, pos, neg, &out->m, &out->m##Dir))
+#define DECODE_INT(m,name,bit,max) \
+	DECODE_STEP(1, bit, DecodeInt(FIELD_BYTES(k), max, &out->m))
+#define DECODE_CODE(m,name,bit,min,max) \
+	DECODE_STEP(1, bit, DecodeCode(FIELD_BYTES(k), min, max, &out->m))
+#define DECODE_COUNT(m,name,bit,max) \
+	if(FIELD_AVAILABLE(f,k) && f->len[k] == 0) \
+		return NMEA_ERR_MISSING_FIELD; \
+	DECODE_STEP(1, bit, DecodeInt(FIELD_BYTES(k), max, &out->m))
+#define DECODE_FIXED(m,name,bit,scale) \
+	DECODE_STEP(1, bit, DecodeFixed(FIELD_BYTES(k), scale, INT32_MAX, &out->m))
+#define DECODE_UNIT(m,name,bit,scale,unit) \
+	DECODE_STEP(2, bit, DecodeUnit(FIELD_BYTES(k), FIELD_BYTES(k+1), scale, unit, &out->m))
+#define DECODE_CHAR(m,name,bit,a,b) \
+	DECODE_STEP(1, bit, DecodeChar(buf+f->start[k], a, b, &out->m))
+#define DECODE_HEADING(m,name,bit) \
+	DECODE_STEP(1, bit, DecodeHeading(FIELD_BYTES(k), &out->m))
+
+/* Defines decoder 'name' for the result structure 'type' from its schema */
+#define DEFINE_DECODER(name, type, schema) \
+	NMEAStatus name(const char *buf, const NMEAFields *f, type *out) { \
+		NMEAStatus status; \
+		unsigned int k=1; \
+		memset(out, 0, sizeof(*out)); \
+		schema(DECODE) \
+		return CheckTerminator(f, k); \
 	}
-	else {
-		if(p2-buf==0) {
-			printf("Number of Satellites not specified\n");
-			buf++;
-			index++;
-		}
-		else {
-			index+=(p2-buf+1);
-			strncpy(auxBuf, buf, p2 - buf);
-			auxBuf[p2 - buf] = '\0';
-			buf = p2 + 1;
-			if (checkdigit(auxBuf,0)<0) {
-				printf("Number of Satellites must be a number");
-				return;
-			}
-			int q=atoi(auxBuf);
-			if (q<0)
-			{
-				printf("Number of satellites being tracked canot be negative'\n");
-				return;
-			}
-			if (q>12)
-			{
-				printf("Number of satellites being tracked canot be greater than 12'\n");
-				return;
-			}
-			printf("Number of satellites being tracked: %d\n", q);
-		}
+
+#define DECODER(NAME, member, ...) DEFINE_DECODER(GP##NAME##Parser, NMEA##NAME, NAME##_SCHEMA)
+
+/**
+ *  GPGGAparser, GPGSAparser, ...
+ * <p>
+ * These functions, one per sentence type, are used for parsing the sentences of their
+ * type from any talker.
+ * <p>
+ *
+ * @param  buf Buffer containing the input string read from the file
+ * @param  f Field table produced by NMEATokenize for buf
+ * @param  out Structure receiving the decoded fields
+ * @return NMEA_OK if the sentence is valid, else the reason it was rejected
+ */
+NMEA_SENTENCE_TYPES(DECODER)
+
+/*
+ * Sentence formatters, indexed by (second ^ third letter) & 7, which happens to be a
+ * perfect hash of the five supported ones; a new formatter whose slot is taken overrides
+ * its initializer, which -Wextra reports. The code is the formatter's three letters as a
+ * little-endian integer; unused slots hold 0, which no letters produce.
+ */
+#define FORMATTER_CODE(a,b,c) ((uint32_t)(unsigned char)(a) | (uint32_t)(unsigned char)(b)<<8 | (uint32_t)(unsigned char)(c)<<16)
+#define FORMATTER_HASH(b,c) (((unsigned char)(b) ^ (unsigned char)(c)) & 7)
+
+#define FORMATTER_ENTRY(NAME, member, a, b, c) [FORMATTER_HASH(b,c)] = { FORMATTER_CODE(a,b,c), NMEA_TYPE_##NAME },
+
+static const struct {
+	uint32_t code;
+	NMEAType type;
+} formatterTable[8] = {
+	NMEA_SENTENCE_TYPES(FORMATTER_ENTRY)
+};
+
+/**
+ * NMEAParseType
+ * <p>
+ * This function identifies the sentence type from the address field in constant time.
+ * The two-letter talker ID (GP, GN, GL, GA, GB, GQ, ...) may be any pair of capital
+ * letters and does not affect the type; only the three-letter formatter selects it.
+ * <p>
+ *
+ * @param  buf Buffer containing the sentence
+ * @param  f Field table of the sentence
+ * @return Sentence type, NMEA_TYPE_UNKNOWN if the address is not a supported one
+ */
+static NMEAType NMEAParseType(const char *buf, const NMEAFields *f) {
+	const char *addr = buf + f->start[0];
+	unsigned int slot;
+	if(f->count == 0 || f->len[0] != 5)
+		return NMEA_TYPE_UNKNOWN;
+	if((unsigned char)(addr[0]-'A') >= 26 || (unsigned char)(addr[1]-'A') >= 26)
+		return NMEA_TYPE_UNKNOWN;
+	slot = FORMATTER_HASH(addr[3], addr[4]);
+	if(formatterTable[slot].code != FORMATTER_CODE(addr[2], addr[3], addr[4]))
+		return NMEA_TYPE_UNKNOWN;
+	return formatterTable[slot].type;
+}
+
+/**
+ * NMEADecodeSentence
+ * <p>
+ * This function verifies the checksum of an already tokenized sentence and decodes it
+ * with the parser for its type, tagging the result with the sentence's talker ID. A
+ * sentence whose checksum does not match is not decoded.
+ * <p>
+ *
+ * @param  buf Buffer containing a sanitized sentence starting with '$'
+ * @param  bufSize Length of the sentence
+ * @param  fields Field table of the sentence
+ * @param  type Sentence type identified from the address field
+ * @param  out Structure receiving the sentence type and decoded fields
+ * @return NMEA_OK if the sentence is valid, else the reason it was rejected
+ */
+NMEAStatus NMEADecodeSentence(const char *buf, unsigned int bufSize, const NMEAFields *fields, NMEAType type, NMEASentence *out) {
+	NMEAStatus status;
+	out->type = type;
+	out->talker[0] = '\0';
+	out->source = 0;
+	if(type == NMEA_TYPE_UNKNOWN)
+		return NMEA_ERR_UNSUPPORTED;
+	memcpy(out->talker, buf + fields->start[0], 2);
+	out->talker[2] = '\0';
+	if((status = CompareChecksum(buf, bufSize, fields->star < 0 ? NULL : buf + fields->star)) != NMEA_OK) {
+		memset(&out->u, 0, sizeof(out->u));
+		return status;
 	}
-	
-	// HDOP
-	if(index>=bufSize)
-	{
-		printf("End of string");
-		return;
+	switch(type) {
+#define DECODE_CASE(NAME, member, ...) \
+		case NMEA_TYPE_##NAME: \
+			return GP##NAME##Parser(buf, fields, &out->u.member);
+		NMEA_SENTENCE_TYPES(DECODE_CASE)
+		default:
+			return NMEA_ERR_UNSUPPORTED;
 	}
-	if((p2=strchr(buf,','))==NULL) {	
-		printf("Wrong format\n");
-		return;
+}
+
+/**
+ * NMEAParseSentence
+ * <p>
+ * This function tokenizes the sentence, verifies the checksum, selects the parser for the
+ * sentence type and decodes the sentence into out. A sentence whose checksum does not
+ * match is not decoded.
+ * <p>
+ *
+ * @param  buf Buffer containing a sanitized sentence starting with '$'
+ * @param  bufSize Length of the sentence
+ * @param  out Structure receiving the sentence type and decoded fields
+ * @return NMEA_OK if the sentence is valid, else the reason it was rejected
+ */
+NMEAStatus NMEAParseSentence(const char *buf, unsigned int bufSize, NMEASentence *out) {
+	NMEAFields fields;
+	NMEATokenize(buf, bufSize, &fields);
+	return NMEADecodeSentence(buf, bufSize, &fields, NMEAParseType(buf, &fields), out);
+}
+
+/* Stores the next logical field of the record 'r' in v[n]; characters as their code */
+#define VALUE_FIELD(m) v[n++] = r->m;
+#define VALUE_TIME(m,...) VALUE_FIELD(m)
+#define VALUE_COORD(m,...) VALUE_FIELD(m)
+#define VALUE_INT(m,...) VALUE_FIELD(m)
+#define VALUE_CODE(m,...) VALUE_FIELD(m)
+#define VALUE_COUNT(m,...) VALUE_FIELD(m)
+#define VALUE_FIXED(m,...) VALUE_FIELD(m)
+#define VALUE_UNIT(m,...) VALUE_FIELD(m)
+#define VALUE_CHAR(m,...) VALUE_FIELD(m)
+#define VALUE_HEADING(m,...) VALUE_FIELD(m)
+
+#define DEFINE_VALUES(name, type, schema) \
+	static unsigned int name(const type *r, int32_t *v, unsigned int *valid) { \
+		unsigned int n=0; \
+		schema(VALUE) \
+		*valid = r->valid; \
+		return n; \
 	}
-	else {
-		if(p2-buf==0) {
-			printf("HDOP not specified\n");
-			buf++;
-			index++;
-		}
-		else {
-			index+=(p2-buf+1);
-			strncpy(auxBuf, buf, p2 - buf);
-			auxBuf[p2 - buf] = '\0';
-			buf = p2 + 1;
-			if (checkdigit(auxBuf,1)<0) {
-				printf("HDOP must be a number");
-				return;
-			}
-			printf("Horizontal dilution of position (HDOP): %s\n", auxBuf);
-		}
+
+#define VALUES(NAME, member, ...) DEFINE_VALUES(NAME##Values, NMEA##NAME, NAME##_SCHEMA)
+
+NMEA_SENTENCE_TYPES(VALUES)
+
+/*
+ * Logical fields of a decoded sentence as int32 values, value k belonging to bit k of
+ * the sentence's valid mask. Characters are stored as their code. Returns the number of
+ * values, 0 for an unknown type.
+ */
+static unsigned int SentenceValues(const NMEASentence *s, int32_t *v, unsigned int *valid) {
+	switch(s->type) {
+#define VALUES_CASE(NAME, member, ...) \
+		case NMEA_TYPE_##NAME: \
+			return NAME##Values(&s->u.member, v, valid);
+		NMEA_SENTENCE_TYPES(VALUES_CASE)
+		default:
+			*valid = 0;
+			return 0;
 	}
-	
-	// Altitude
-	if(index>=bufSize)
-	{
-		printf("End of string");
-		return;
+}
+
+/* Columns of a FIX record before its list of PRNs, see fixColumns */
+#define FIX_VALUES 13
+
+/* Most values of an assembler record, reached by a FIX record with every PRN */
+#define RECORD_MAX_VALUES (FIX_VALUES + NMEA_FIX_MAX_PRN)
+
+/*
+ * Values of the FIX record of an assembled epoch, in the order of fixColumns: position
+ * from GGA or else GLL, HDOP from GSA or else GGA, as in the text report. The 'prns'
+ * value is the number of PRNs used, which follow the record's values in v.
+ */
+static unsigned int FixValues(const NMEAFix *fix, int32_t *v, unsigned int *valid) {
+	const NMEAGGA *gga = fix->have & NMEA_EPOCH_GGA ? &fix->gga : NULL;
+	const NMEAGLL *gll = fix->have & NMEA_EPOCH_GLL ? &fix->gll : NULL;
+	const NMEAGSA *gsa = fix->have & NMEA_EPOCH_GSA ? &fix->gsa : NULL;
+	const NMEAGST *gst = fix->have & NMEA_EPOCH_GST ? &fix->gst : NULL;
+	unsigned int i;
+	*valid = 1;
+	v[0] = fix->time;
+	if(gga != NULL && (gga->valid & NMEA_GGA_LAT))
+		v[1] = gga->lat, *valid |= 1u<<1;
+	else if(gll != NULL && (gll->valid & NMEA_GLL_LAT))
+		v[1] = gll->lat, *valid |= 1u<<1;
+	if(gga != NULL && (gga->valid & NMEA_GGA_LON))
+		v[2] = gga->lon, *valid |= 1u<<2;
+	else if(gll != NULL && (gll->valid & NMEA_GLL_LON))
+		v[2] = gll->lon, *valid |= 1u<<2;
+	if(gga != NULL) {
+		v[3] = gga->quality;
+		v[4] = gga->satellites;
+		v[5] = gga->altitude;
+		*valid |= (gga->valid & NMEA_GGA_QUALITY ? 1u<<3 : 0) | (gga->valid & NMEA_GGA_SATS ? 1u<<4 : 0)
+			| (gga->valid & NMEA_GGA_ALT ? 1u<<5 : 0);
 	}
-	if((p2=strchr(buf,','))==NULL) {	
-		printf("Wrong format\n");
-		return;
+	if(gsa != NULL) {
+		v[6] = gsa->pdop;
+		v[7] = gsa->hdop;
+		v[8] = gsa->vdop;
+		*valid |= (gsa->valid & NMEA_GSA_PDOP ? 1u<<6 : 0) | (gsa->valid & NMEA_GSA_HDOP ? 1u<<7 : 0)
+			| (gsa->valid & NMEA_GSA_VDOP ? 1u<<8 : 0);
 	}
-	else {
-		if(p2-buf==0) {
-			printf("Altitude not specified\n");
-			buf++;
-			index++;
-		}
-		else {
-			index+=(p2-buf+1);
-			strncpy(auxBuf, buf, p2 - buf);
-			auxBuf[p2 - buf] = '\0';
-			buf = p2 + 1;
-			if (checkdigit(auxBuf,1)<0) {
-				printf("Altitude must be a number");
-				return;
-			}
-			if((p2 = strchr(buf, ',')) == NULL) {
-				printf("Wrong format");
-				exit(0);
-			}
-			if(p2 - buf != 1) {
-				printf("\nNot valid GPGGA sentence format, Unit of altitude measurement missing\n");
-				return;
-			}
-			if(*buf == 'M')
-				printf("Altitude (m) above mean sea level: %s\n", auxBuf);
-			else {
-				printf("Wrong unit for altitude measurement specified.");
-				return;
-			}
-			index+=(p2-buf+1);
-			buf = p2 + 1;
-		}
+	else if(gga != NULL && (gga->valid & NMEA_GGA_HDOP))
+		v[7] = gga->hdop, *valid |= 1u<<7;
+	if(gst != NULL) {
+		v[9] = gst->sigmaLat;
+		v[10] = gst->sigmaLon;
+		v[11] = gst->sigmaAlt;
+		*valid |= (gst->valid & NMEA_GST_SIGMA_LAT ? 1u<<9 : 0) | (gst->valid & NMEA_GST_SIGMA_LON ? 1u<<10 : 0)
+			| (gst->valid & NMEA_GST_SIGMA_ALT ? 1u<<11 : 0);
 	}
-	
-	// Height of geoid
-	if(index>=bufSize)
-	{
-		printf("End of string");
+	v[12] = fix->prns;
+	if(gsa != NULL)
+		*valid |= 1u<<12;
+	for(i=0;i<fix->prns;i++)
+		v[FIX_VALUES + i] = fix->prn[i];
+	return FIX_VALUES;
+}
+
+/* Values of the SKY record of satellite i of a sky view, in the order of skyColumns */
+static unsigned int SkyValues(const NMEASkyView *view, unsigned int i, int32_t *v, unsigned int *valid) {
+	const NMEASatellite *sv = &view->sv[i];
+	v[0] = view->messages;
+	v[1] = view->satellitesInView;
+	v[2] = i + 1;
+	v[3] = sv->prn;
+	v[4] = sv->elevation;
+	v[5] = sv->azimuth;
+	v[6] = sv->snr;
+	*valid = 7u | (unsigned int)view->svValid[i] << 3;
+	return 7;
+}
+
+/* Appends one row to a column set; values[k] is column k, present when bit k of valid is set */
+static void AppendRow(NMEAColumns *c, const int32_t *values, unsigned int nColumns, unsigned int valid) {
+	size_t row = c->rows++;
+	unsigned int k;
+	for(k=0;k<nColumns;k++) {
+		NMEAColumn *col = &c->column[k];
+		uint8_t bit = 1u << (row & 7);
+		if(col->values == NULL)
+			continue;
+		col->values[row] = (valid >> k) & 1 ? values[k] : 0;
+		if(col->valid == NULL)
+			continue;
+		if((valid >> k) & 1)
+			col->valid[row >> 3] |= bit;
+		else
+			col->valid[row >> 3] &= ~bit;
+	}
+}
+
+/* Column set of a sentence type, or NULL if the batch does not collect that type */
+static NMEAColumns *BatchColumns(NMEABatch *b, NMEAType type) {
+	switch(type) {
+#define BATCH_CASE(NAME, member, ...) \
+		case NMEA_TYPE_##NAME: \
+			return b->member;
+		NMEA_SENTENCE_TYPES(BATCH_CASE)
+		default:
+			return NULL;
+	}
+}
+
+/**
+ * NMEADecodeBatch
+ * <p>
+ * This function decodes a buffer of many sentences, one per line, and appends their
+ * values column by column to the caller's column set of their type. Only sentences that
+ * parse without error become rows; empty fields are rows with their validity bit clear.
+ * Sentences of a type with no column set are verified and decoded all the same,
+ * so the counters agree with a normal run over the same lines, but dropped. Lines longer
+ * than MAX_INPUT_LINE_LENGTH are skipped and counted. Decoding stops before a sentence
+ * whose column set is full, so the caller can drain the columns and call again with the
+ * rest of the buffer.
+ * <p>
+ *
+ * @param  data Whole lines of input; the last one may lack its newline
+ * @param  size Size of the buffer
+ * @param  batch Column sets receiving the rows, and counters of sentences seen, rejected and oversized
+ * @return Number of bytes consumed, size unless a column set filled up
+ */
+size_t NMEADecodeBatch(const char *data, size_t size, NMEABatch *batch) {
+	char scratch[MAX_INPUT_LINE_LENGTH+1];
+	const char *p = data, *end = data + size;
+	while(p < end) {
+		const char *nl = memchr(p, '\n', end - p);
+		size_t len = (nl != NULL ? nl : end) - p;
+		NMEAScannedLine scan;
+		NMEASentence s;
+		NMEAColumns *c;
+		int32_t v[NMEA_MAX_COLUMNS];
+		unsigned int n, valid;
+		if(len > MAX_INPUT_LINE_LENGTH) {
+			batch->oversized++;
+			p += len + 1;
+			continue;
+		}
+		NMEAScanLine(p, len, scratch, &scan);
+		if(scan.len == 0 || scan.buf[0] != '$') {
+			p += len + 1;
+			continue;
+		}
+		if(scan.errorLoc > 0) {
+			batch->sentences++;
+			batch->rejected++;
+			p += len + 1;
+			continue;
+		}
+		c = BatchColumns(batch, scan.type);
+		if(c != NULL && c->rows == c->capacity)
+			break;
+		batch->sentences++;
+		if(NMEADecodeSentence(scan.buf, scan.len, &scan.fields, scan.type, &s) != NMEA_OK) {
+			batch->rejected++;
+			p += len + 1;
+			continue;
+		}
+		if(c == NULL) {
+			p += len + 1;
+			continue;
+		}
+		n = SentenceValues(&s, v, &valid);
+		AppendRow(c, v, n, valid);
+		p += len + 1;
+	}
+	return p < end ? (size_t)(p - data) : size;
+}
+
+/*
+ * Columns of the tabular outputs (Arrow export, CSV and NDJSON sinks), in the fixed-point
+ * units of the result structures. Kinds: int32, time of day in milliseconds, one
+ * character, and a list of int32 (the CSV and NDJSON records of the assemblers only).
+ */
+enum {
+	COLUMN_INT32,
+	COLUMN_TIME,
+	COLUMN_CHAR,
+	COLUMN_LIST
+};
+
+typedef struct {
+	const char *name;
+	int kind;
+} ColumnSpec;
+
+/* Column k of a type is its logical field k, as returned by SentenceValues */
+#define SPEC_TIME(m,name,...) { name, COLUMN_TIME },
+#define SPEC_COORD(m,name,...) { name, COLUMN_INT32 },
+#define SPEC_INT(m,name,...) { name, COLUMN_INT32 },
+#define SPEC_CODE(m,name,...) { name, COLUMN_INT32 },
+#define SPEC_COUNT(m,name,...) { name, COLUMN_INT32 },
+#define SPEC_FIXED(m,name,...) { name, COLUMN_INT32 },
+#define SPEC_UNIT(m,name,...) { name, COLUMN_INT32 },
+#define SPEC_CHAR(m,name,...) { name, COLUMN_CHAR },
+#define SPEC_HEADING(m,name,...) { name, COLUMN_INT32 },
+
+/* Column table member##Columns of a type; the array type fails to compile if it has more than NMEA_MAX_COLUMNS */
+#define COLUMNS(NAME, member, ...) \
+	static const ColumnSpec member##Columns[] = { NAME##_SCHEMA(SPEC) }; \
+	typedef char member##ColumnsFit[sizeof(member##Columns)/sizeof(ColumnSpec) <= NMEA_MAX_COLUMNS ? 1 : -1];
+
+NMEA_SENTENCE_TYPES(COLUMNS)
+
+/*
+ * Records of the assemblers in the CSV and NDJSON sinks: FIX for the fix of an epoch (-e)
+ * and SKY for each satellite of a sky view (-k). Their columns take the names and units
+ * of the sentence columns they come from.
+ */
+enum {
+	RECORD_FIX = NMEA_TYPE_COUNT,
+	RECORD_SKY,
+	RECORD_COUNT
+};
+
+static const ColumnSpec fixColumns[FIX_VALUES] = {
+	{ "time", COLUMN_TIME }, { "latitude_e7", COLUMN_INT32 }, { "longitude_e7", COLUMN_INT32 },
+	{ "quality", COLUMN_INT32 }, { "satellites", COLUMN_INT32 }, { "altitude_mm", COLUMN_INT32 },
+	{ "pdop_x100", COLUMN_INT32 }, { "hdop_x100", COLUMN_INT32 }, { "vdop_x100", COLUMN_INT32 },
+	{ "sigma_lat_mm", COLUMN_INT32 }, { "sigma_lon_mm", COLUMN_INT32 }, { "sigma_alt_mm", COLUMN_INT32 },
+	{ "prns", COLUMN_LIST }
+};
+
+static const ColumnSpec skyColumns[] = {
+	{ "total_messages", COLUMN_INT32 }, { "satellites_in_view", COLUMN_INT32 }, { "satellite", COLUMN_INT32 },
+	{ "prn", COLUMN_INT32 }, { "elevation", COLUMN_INT32 }, { "azimuth", COLUMN_INT32 }, { "snr", COLUMN_INT32 }
+};
+
+#define COLUMN_SCHEMA(NAME, member, ...) \
+	[NMEA_TYPE_##NAME] = { #NAME, member##Columns, sizeof(member##Columns)/sizeof(member##Columns[0]) },
+
+static const struct {
+	const char *name;
+	const ColumnSpec *columns;
+	unsigned int count;
+} columnSchemas[RECORD_COUNT] = {
+	NMEA_SENTENCE_TYPES(COLUMN_SCHEMA)
+	[RECORD_FIX] = { "FIX", fixColumns, FIX_VALUES },
+	[RECORD_SKY] = { "SKY", skyColumns, sizeof(skyColumns)/sizeof(skyColumns[0]) }
+};
+
+/*
+ * Arrow IPC file export. A minimal FlatBuffers builder writes the Schema, RecordBatch
+ * and Footer metadata by hand, so no Arrow or FlatBuffers library is needed. Unlike
+ * the usual back-to-front builders this one writes front to back: a table is written
+ * whole with its references left open, then its children follow and the references are
+ * patched, which keeps every uoffset pointing forward as the format requires.
+ */
+
+typedef struct {
+	uint8_t *buf;
+	size_t len;
+	size_t cap;
+	int error;
+} FlatBuilder;
+
+typedef struct {
+	size_t vtable;
+	size_t table;
+} FlatTable;
+
+/* Appends n zero bytes and returns their position; on allocation failure sets error */
+static size_t FbReserve(FlatBuilder *b, size_t n) {
+	size_t pos = b->len;
+	if(n == 0)
+		return pos;
+	if(b->len + n > b->cap) {
+		size_t cap = b->cap ? b->cap : 1024;
+		uint8_t *buf;
+		while(cap < b->len + n)
+			cap *= 2;
+		if((buf = realloc(b->buf, cap)) == NULL) {
+			b->error = 1;
+			return 0;
+		}
+		b->buf = buf;
+		b->cap = cap;
+	}
+	memset(b->buf + pos, 0, n);
+	b->len += n;
+	return pos;
+}
+
+static void FbPad(FlatBuilder *b, size_t align) {
+	if(b->len % align != 0)
+		FbReserve(b, align - b->len % align);
+}
+
+/* Little-endian store of a scalar of 'size' bytes */
+static void FbPut(FlatBuilder *b, size_t pos, uint64_t v, size_t size) {
+	size_t i;
+	if(b->error)
+		return;
+	for(i=0;i<size;i++)
+		b->buf[pos+i] = (uint8_t)(v >> (8*i));
+}
+
+/* Starts a table with room for 'slots' fields; the vtable goes right before it */
+static void FbTableStart(FlatBuilder *b, FlatTable *t, unsigned int slots) {
+	FbPad(b, 2);
+	t->vtable = FbReserve(b, 4 + 2*slots);
+	FbPut(b, t->vtable, 4 + 2*slots, 2);
+	FbPad(b, 4);
+	t->table = FbReserve(b, 4);
+	FbPut(b, t->table, t->table - t->vtable, 4);
+}
+
+/* Adds a field of 'size' bytes, aligned to its size, and returns its position */
+static size_t FbTableField(FlatBuilder *b, FlatTable *t, unsigned int slot, size_t size) {
+	size_t pos;
+	FbPad(b, size);
+	pos = FbReserve(b, size);
+	FbPut(b, t->vtable + 4 + 2*slot, pos - t->table, 2);
+	return pos;
+}
+
+static void FbTableScalar(FlatBuilder *b, FlatTable *t, unsigned int slot, uint64_t v, size_t size) {
+	FbPut(b, FbTableField(b, t, slot, size), v, size);
+}
+
+static void FbTableEnd(FlatBuilder *b, FlatTable *t) {
+	FbPut(b, t->vtable + 2, b->len - t->table, 2);
+}
+
+/* Points the uoffset at ref to target, which must come after it */
+static void FbPatch(FlatBuilder *b, size_t ref, size_t target) {
+	FbPut(b, ref, target - ref, 4);
+}
+
+/* Starts a vector of count elements of elemSize bytes aligned to align; returns its position */
+static size_t FbVector(FlatBuilder *b, size_t count, size_t elemSize, size_t align) {
+	size_t pos;
+	FbPad(b, 4);
+	while((b->len + 4) % align != 0)
+		FbReserve(b, 4);
+	pos = FbReserve(b, 4 + count*elemSize);
+	FbPut(b, pos, count, 4);
+	return pos;
+}
+
+static size_t FbString(FlatBuilder *b, const char *s) {
+	size_t n = strlen(s), pos;
+	FbPad(b, 4);
+	pos = FbReserve(b, 4 + n + 1);
+	FbPut(b, pos, n, 4);
+	if(!b->error)
+		memcpy(b->buf + pos + 4, s, n);
+	return pos;
+}
+
+/* Arrow format constants, from Schema.fbs and Message.fbs */
+enum {
+	ARROW_METADATA_V5 = 4,
+	ARROW_HEADER_SCHEMA = 1,
+	ARROW_HEADER_RECORD_BATCH = 3,
+	ARROW_TYPE_INT = 2,
+	ARROW_TYPE_UTF8 = 5,
+	ARROW_TYPE_TIME = 9,
+	ARROW_TIME_UNIT_MILLISECOND = 1
+};
+
+/* One Field table with its name, type and empty children */
+static void ArrowBuildField(FlatBuilder *b, size_t ref, const char *name, int kind, int nullable) {
+	FlatTable field, type;
+	size_t nameRef, typeRef, childrenRef;
+	FbTableStart(b, &field, 6);
+	FbPatch(b, ref, field.table);
+	nameRef = FbTableField(b, &field, 0, 4);
+	FbTableScalar(b, &field, 1, nullable, 1);
+	FbTableScalar(b, &field, 2, kind == COLUMN_INT32 ? ARROW_TYPE_INT : kind == COLUMN_TIME ? ARROW_TYPE_TIME : ARROW_TYPE_UTF8, 1);
+	typeRef = FbTableField(b, &field, 3, 4);
+	childrenRef = FbTableField(b, &field, 5, 4);
+	FbTableEnd(b, &field);
+	FbPatch(b, nameRef, FbString(b, name));
+	if(kind == COLUMN_INT32) {
+		FbTableStart(b, &type, 2);
+		FbTableScalar(b, &type, 0, 32, 4);
+		FbTableScalar(b, &type, 1, 1, 1);
+	}
+	else if(kind == COLUMN_TIME) {
+		FbTableStart(b, &type, 2);
+		FbTableScalar(b, &type, 0, ARROW_TIME_UNIT_MILLISECOND, 2);
+		FbTableScalar(b, &type, 1, 32, 4);
+	}
+	else
+		FbTableStart(b, &type, 0);
+	FbTableEnd(b, &type);
+	FbPatch(b, typeRef, type.table);
+	FbPatch(b, childrenRef, FbVector(b, 0, 4, 4));
+}
+
+/* Schema table: a "talker" string column followed by the columns of the sentence type */
+static void ArrowBuildSchema(FlatBuilder *b, size_t ref, NMEAType type) {
+	FlatTable schema;
+	size_t fieldsRef, fields;
+	unsigned int i, n = columnSchemas[type].count;
+	FbTableStart(b, &schema, 2);
+	FbPatch(b, ref, schema.table);
+	FbTableScalar(b, &schema, 0, 0, 2);
+	fieldsRef = FbTableField(b, &schema, 1, 4);
+	FbTableEnd(b, &schema);
+	fields = FbVector(b, n + 1, 4, 4);
+	FbPatch(b, fieldsRef, fields);
+	ArrowBuildField(b, fields + 4, "talker", COLUMN_CHAR, 0);
+	for(i=0;i<n;i++)
+		ArrowBuildField(b, fields + 8 + 4*i, columnSchemas[type].columns[i].name, columnSchemas[type].columns[i].kind, 1);
+}
+
+/* Message table; returns the position of its header reference */
+static size_t ArrowBuildMessage(FlatBuilder *b, int headerType, uint64_t bodyLength) {
+	FlatTable message;
+	size_t root = FbReserve(b, 4), headerRef;
+	FbTableStart(b, &message, 4);
+	FbPatch(b, root, message.table);
+	FbTableScalar(b, &message, 0, ARROW_METADATA_V5, 2);
+	FbTableScalar(b, &message, 1, headerType, 1);
+	headerRef = FbTableField(b, &message, 2, 4);
+	FbTableScalar(b, &message, 3, bodyLength, 8);
+	FbTableEnd(b, &message);
+	return headerRef;
+}
+
+/* Writes bytes to the file and advances its offset */
+static void ArrowWrite(NMEAArrowWriter *w, const void *data, size_t len) {
+	if(w->error == 0 && fwrite(data, 1, len, w->fp) != len)
+		w->error = 1;
+	w->offset += len;
+}
+
+/* Encapsulated message: continuation marker, metadata length, metadata padded to 8, body */
+static void ArrowWriteMessage(NMEAArrowWriter *w, FlatBuilder *meta, const FlatBuilder *body) {
+	uint8_t prefix[8] = { 0xFF, 0xFF, 0xFF, 0xFF };
+	uint64_t start = w->offset;
+	FbPad(meta, 8);
+	if(meta->error || (body != NULL && body->error)) {
+		w->error = 1;
+		return;
+	}
+	prefix[4] = meta->len & 0xFF;
+	prefix[5] = (meta->len >> 8) & 0xFF;
+	prefix[6] = (meta->len >> 16) & 0xFF;
+	prefix[7] = (meta->len >> 24) & 0xFF;
+	ArrowWrite(w, prefix, sizeof(prefix));
+	ArrowWrite(w, meta->buf, meta->len);
+	if(body != NULL) {
+		ArrowWrite(w, body->buf, body->len);
+		if(w->nBlocks == w->capBlocks) {
+			size_t cap = w->capBlocks ? 2*w->capBlocks : 16;
+			NMEAArrowBlock *blocks = realloc(w->blocks, cap * sizeof(*blocks));
+			if(blocks == NULL) {
+				w->error = 1;
+				return;
+			}
+			w->blocks = blocks;
+			w->capBlocks = cap;
+		}
+		w->blocks[w->nBlocks].offset = start;
+		w->blocks[w->nBlocks].metaDataLength = 8 + meta->len;
+		w->blocks[w->nBlocks].bodyLength = body->len;
+		w->nBlocks++;
+	}
+}
+
+/* Appends one body buffer, padded to 8 bytes, and records its offset and length */
+static void ArrowBodyBuffer(FlatBuilder *body, uint64_t *buffers, unsigned int *nBuffers, const void *data, size_t len) {
+	size_t pos = FbReserve(body, len);
+	if(!body->error && len > 0)
+		memcpy(body->buf + pos, data, len);
+	FbPad(body, 8);
+	buffers[2 * *nBuffers] = pos;
+	buffers[2 * *nBuffers + 1] = len;
+	(*nBuffers)++;
+}
+
+/* Writes the rows collected so far as one record batch */
+static void ArrowFlush(NMEAArrowWriter *w) {
+	uint64_t nodes[2*(NMEA_MAX_COLUMNS+1)], buffers[2*(3*NMEA_MAX_COLUMNS+3)];
+	unsigned int nBuffers = 0, k, i;
+	size_t rows = w->rows, bitmapBytes = (rows + 7) / 8, batchRef, nodesRef, buffersRef, pos;
+	FlatBuilder meta, body;
+	FlatTable batch;
+	int32_t *offsets;
+	char *chars;
+	if(rows == 0)
+		return;
+	memset(&meta, 0, sizeof(meta));
+	memset(&body, 0, sizeof(body));
+	offsets = malloc((rows + 1) * sizeof(*offsets));
+	chars = malloc(2 * rows);
+	if(offsets == NULL || chars == NULL) {
+		w->error = 1;
+		free(offsets);
+		free(chars);
+		return;
+	}
+	// Talker: no nulls, so no validity buffer
+	for(i=0;i<=rows;i++)
+		offsets[i] = 2*i;
+	nodes[0] = rows;
+	nodes[1] = 0;
+	ArrowBodyBuffer(&body, buffers, &nBuffers, NULL, 0);
+	ArrowBodyBuffer(&body, buffers, &nBuffers, offsets, (rows + 1) * sizeof(*offsets));
+	ArrowBodyBuffer(&body, buffers, &nBuffers, w->talker, 2 * rows);
+	for(k=0;k<w->columns;k++) {
+		const uint8_t *valid = w->valid + k * ((w->batchRows + 7) / 8);
+		const int32_t *values = w->values + k * w->batchRows;
+		size_t nulls = 0, n = 0;
+		for(i=0;i<rows;i++)
+			nulls += !((valid[i >> 3] >> (i & 7)) & 1);
+		nodes[2*(k+1)] = rows;
+		nodes[2*(k+1)+1] = nulls;
+		ArrowBodyBuffer(&body, buffers, &nBuffers, valid, bitmapBytes);
+		if(columnSchemas[w->type].columns[k].kind != COLUMN_CHAR) {
+			ArrowBodyBuffer(&body, buffers, &nBuffers, values, rows * sizeof(*values));
+			continue;
+		}
+		for(i=0;i<rows;i++) {
+			offsets[i] = n;
+			if((valid[i >> 3] >> (i & 7)) & 1)
+				chars[n++] = (char)values[i];
+		}
+		offsets[rows] = n;
+		ArrowBodyBuffer(&body, buffers, &nBuffers, offsets, (rows + 1) * sizeof(*offsets));
+		ArrowBodyBuffer(&body, buffers, &nBuffers, chars, n);
+	}
+	free(offsets);
+	free(chars);
+
+	batchRef = ArrowBuildMessage(&meta, ARROW_HEADER_RECORD_BATCH, body.len);
+	FbTableStart(&meta, &batch, 3);
+	FbPatch(&meta, batchRef, batch.table);
+	FbTableScalar(&meta, &batch, 0, rows, 8);
+	nodesRef = FbTableField(&meta, &batch, 1, 4);
+	buffersRef = FbTableField(&meta, &batch, 2, 4);
+	FbTableEnd(&meta, &batch);
+	pos = FbVector(&meta, w->columns + 1, 16, 8);
+	FbPatch(&meta, nodesRef, pos);
+	for(i=0;i<2*(w->columns+1);i++)
+		FbPut(&meta, pos + 4 + 8*i, nodes[i], 8);
+	pos = FbVector(&meta, nBuffers, 16, 8);
+	FbPatch(&meta, buffersRef, pos);
+	for(i=0;i<2*nBuffers;i++)
+		FbPut(&meta, pos + 4 + 8*i, buffers[i], 8);
+	ArrowWriteMessage(w, &meta, &body);
+	free(meta.buf);
+	free(body.buf);
+	w->rows = 0;
+	memset(w->valid, 0, w->columns * ((w->batchRows + 7) / 8));
+}
+
+/**
+ * NMEAArrowOpen
+ * <p>
+ * This function creates an Arrow IPC file for the sentences of one type and writes its
+ * schema: a "talker" string column followed by one column per logical field, int32 in
+ * the fixed-point units of the result structures, time32[ms] for times and a one
+ * character string for GSA mode and GLL status. Empty fields are nulls.
+ * <p>
+ *
+ * @param  w Writer to initialize
+ * @param  path File to create
+ * @param  type Sentence type the file holds
+ * @param  batchRows Rows per record batch, 0 for NMEA_ARROW_BATCH_ROWS
+ * @return 0 on success, -1 with errno set on failure
+ */
+int NMEAArrowOpen(NMEAArrowWriter *w, const char *path, NMEAType type, size_t batchRows) {
+	static const uint8_t magic[8] = { 'A', 'R', 'R', 'O', 'W', '1', 0, 0 };
+	FlatBuilder meta;
+	memset(w, 0, sizeof(*w));
+	if(type == NMEA_TYPE_UNKNOWN || type >= NMEA_TYPE_COUNT) {
+		errno = EINVAL;
+		return -1;
+	}
+	w->type = type;
+	w->columns = columnSchemas[type].count;
+	w->batchRows = batchRows ? batchRows : NMEA_ARROW_BATCH_ROWS;
+	w->values = malloc(w->columns * w->batchRows * sizeof(*w->values));
+	w->valid = calloc(w->columns, (w->batchRows + 7) / 8);
+	w->talker = malloc(2 * w->batchRows);
+	if(w->values == NULL || w->valid == NULL || w->talker == NULL || (w->fp = fopen(path, "wb")) == NULL) {
+		free(w->values);
+		free(w->valid);
+		free(w->talker);
+		if(w->fp == NULL && errno == 0)
+			errno = ENOMEM;
+		return -1;
+	}
+	ArrowWrite(w, magic, sizeof(magic));
+	memset(&meta, 0, sizeof(meta));
+	ArrowBuildSchema(&meta, ArrowBuildMessage(&meta, ARROW_HEADER_SCHEMA, 0), type);
+	ArrowWriteMessage(w, &meta, NULL);
+	free(meta.buf);
+	return w->error ? -1 : 0;
+}
+
+/**
+ * NMEAArrowAppend
+ * <p>
+ * This function adds a decoded sentence of the writer's type as a row, writing a record
+ * batch whenever batchRows rows have been collected.
+ * <p>
+ *
+ * @param  w Writer opened by NMEAArrowOpen
+ * @param  s Sentence decoded without error
+ * @return 0 on success, -1 if the sentence has another type or the file could not be written
+ */
+int NMEAArrowAppend(NMEAArrowWriter *w, const NMEASentence *s) {
+	int32_t v[NMEA_MAX_COLUMNS];
+	unsigned int valid, k;
+	size_t row = w->rows;
+	if(s->type != w->type)
+		return -1;
+	SentenceValues(s, v, &valid);
+	memcpy(w->talker + 2*row, s->talker, 2);
+	for(k=0;k<w->columns;k++) {
+		w->values[k * w->batchRows + row] = (valid >> k) & 1 ? v[k] : 0;
+		if((valid >> k) & 1)
+			w->valid[k * ((w->batchRows + 7) / 8) + (row >> 3)] |= 1u << (row & 7);
+	}
+	if(++w->rows == w->batchRows)
+		ArrowFlush(w);
+	return w->error ? -1 : 0;
+}
+
+/**
+ * NMEAArrowClose
+ * <p>
+ * This function writes the last record batch, the end-of-stream marker and the footer
+ * that makes the file readable by memory mapping, then closes it.
+ * <p>
+ *
+ * @param  w Writer opened by NMEAArrowOpen
+ * @return 0 on success, -1 if anything could not be written
+ */
+int NMEAArrowClose(NMEAArrowWriter *w) {
+	static const uint8_t eos[8] = { 0xFF, 0xFF, 0xFF, 0xFF, 0, 0, 0, 0 };
+	static const uint8_t magic[6] = { 'A', 'R', 'R', 'O', 'W', '1' };
+	FlatBuilder meta;
+	FlatTable footer;
+	size_t root, schemaRef, blocksRef, pos, i;
+	uint8_t size[4];
+	ArrowFlush(w);
+	ArrowWrite(w, eos, sizeof(eos));
+	memset(&meta, 0, sizeof(meta));
+	root = FbReserve(&meta, 4);
+	FbTableStart(&meta, &footer, 4);
+	FbPatch(&meta, root, footer.table);
+	FbTableScalar(&meta, &footer, 0, ARROW_METADATA_V5, 2);
+	schemaRef = FbTableField(&meta, &footer, 1, 4);
+	blocksRef = FbTableField(&meta, &footer, 3, 4);
+	FbTableEnd(&meta, &footer);
+	ArrowBuildSchema(&meta, schemaRef, w->type);
+	pos = FbVector(&meta, w->nBlocks, 24, 8);
+	FbPatch(&meta, blocksRef, pos);
+	for(i=0;i<w->nBlocks;i++) {
+		FbPut(&meta, pos + 4 + 24*i, w->blocks[i].offset, 8);
+		FbPut(&meta, pos + 12 + 24*i, w->blocks[i].metaDataLength, 4);
+		FbPut(&meta, pos + 20 + 24*i, w->blocks[i].bodyLength, 8);
+	}
+	if(meta.error)
+		w->error = 1;
+	else {
+		ArrowWrite(w, meta.buf, meta.len);
+		size[0] = meta.len & 0xFF;
+		size[1] = (meta.len >> 8) & 0xFF;
+		size[2] = (meta.len >> 16) & 0xFF;
+		size[3] = (meta.len >> 24) & 0xFF;
+		ArrowWrite(w, size, sizeof(size));
+		ArrowWrite(w, magic, sizeof(magic));
+	}
+	free(meta.buf);
+	if(fclose(w->fp) != 0)
+		w->error = 1;
+	free(w->values);
+	free(w->valid);
+	free(w->talker);
+	free(w->blocks);
+	return w->error ? -1 : 0;
+}
+
+/**
+ * NMEALogClockAdvance
+ * <p>
+ * This function turns a time of day into milliseconds since midnight of the first day
+ * of the log. A time more than 12 hours earlier than the previous one is taken as a
+ * midnight rollover; smaller steps back (sentences slightly out of order) are not. A
+ * time more than 12 hours later than the previous one after a rollover is a late
+ * sentence from the day before, which is placed there and does not move the clock.
+ * <p>
+ *
+ * @param  c Clock of the log, zeroed before the first sentence
+ * @param  ms Time of day of the sentence in milliseconds
+ * @return Time since the start of the first day in milliseconds
+ */
+uint64_t NMEALogClockAdvance(NMEALogClock *c, uint32_t ms) {
+	if(c->started && ms + NMEA_DAY_MS/2 < c->last)
+		c->days++;
+	else if(c->started && c->days > 0 && ms > c->last + NMEA_DAY_MS/2)
+		return (c->days-1) * NMEA_DAY_MS + ms;
+	c->started = 1;
+	c->last = ms;
+	return c->days * NMEA_DAY_MS + ms;
+}
+
+/* Stores the time of day of the record 'r' in *ms, for the TIME entry of a schema */
+#define TIME_TIME(m,name,bit) \
+	*ms = r->m; \
+	return (r->valid & (bit)) != 0;
+#define TIME_COORD(...)
+#define TIME_INT(...)
+#define TIME_CODE(...)
+#define TIME_COUNT(...)
+#define TIME_FIXED(...)
+#define TIME_UNIT(...)
+#define TIME_CHAR(...)
+#define TIME_HEADING(...)
+
+/**
+ * NMEASentenceTime
+ * <p>
+ * This function returns the time of day of a decoded sentence, for the sentence types
+ * that carry one.
+ * <p>
+ *
+ * @param  s Decoded sentence
+ * @param  ms Time of day in milliseconds
+ * @return 1 if the sentence has a time, 0 otherwise
+ */
+int NMEASentenceTime(const NMEASentence *s, uint32_t *ms) {
+	switch(s->type) {
+#define TIME_CASE(NAME, member, ...) \
+		case NMEA_TYPE_##NAME: { \
+			const NMEA##NAME *r = &s->u.member; \
+			(void)r; \
+			NAME##_SCHEMA(TIME) \
+			return 0; \
+		}
+		NMEA_SENTENCE_TYPES(TIME_CASE)
+		default:
+			return 0;
+	}
+}
+
+/* Little-endian store of a 64-bit value */
+static void Store64LE(uint8_t *p, uint64_t v) {
+	int i;
+	for(i=0;i<8;i++)
+		p[i] = (uint8_t)(v >> (8*i));
+}
+
+/* FNV-1a hash of the first NMEA_INDEX_STAMP_BLOCK bytes of a log, for the index stamp */
+static uint64_t IndexStampHash(const char *data, size_t size) {
+	uint64_t h = 0xcbf29ce484222325ull;
+	size_t i;
+	for(i=0;i<size && i<NMEA_INDEX_STAMP_BLOCK;i++)
+		h = (h ^ (uint8_t)data[i]) * 0x100000001b3ull;
+	return h;
+}
+
+/**
+ * NMEAIndexOpen
+ * <p>
+ * This function creates a sidecar time index and writes its header, stamped with the
+ * size and the first block of the log as they are now.
+ * <p>
+ *
+ * @param  w Writer to initialize
+ * @param  path Index file to create
+ * @param  log Log the index is for
+ * @param  interval Timed sentences per entry, 0 for NMEA_INDEX_INTERVAL
+ * @return 0 on success, -1 with errno set on failure
+ */
+int NMEAIndexOpen(NMEAIndexWriter *w, const char *path, const char *log, unsigned int interval) {
+	uint8_t header[NMEA_INDEX_HEADER];
+	char block[NMEA_INDEX_STAMP_BLOCK];
+	struct stat st;
+	size_t n;
+	FILE *fp;
+	memset(w, 0, sizeof(*w));
+	w->interval = interval ? interval : NMEA_INDEX_INTERVAL;
+	if((fp = fopen(log, "rb")) == NULL)
+		return -1;
+	n = fread(block, 1, sizeof(block), fp);
+	if(ferror(fp))
+		errno = EIO;
+	if(ferror(fp) || fstat(fileno(fp), &st) < 0) {
+		fclose(fp);
+		return -1;
+	}
+	fclose(fp);
+	if((w->fp = fopen(path, "wb")) == NULL)
+		return -1;
+	memcpy(header, NMEA_INDEX_MAGIC, 8);
+	Store64LE(header + 8, w->interval);
+	Store64LE(header + 16, (uint64_t)st.st_size);
+	Store64LE(header + 24, IndexStampHash(block, n));
+	if(fwrite(header, 1, sizeof(header), w->fp) != sizeof(header))
+		w->error = 1;
+	return 0;
+}
+
+/**
+ * NMEAIndexAdd
+ * <p>
+ * This function records a timed sentence, writing an entry for every interval-th one.
+ * Sentences must be added in input order.
+ * <p>
+ *
+ * @param  w Writer opened by NMEAIndexOpen
+ * @param  ms Time of day of the sentence in milliseconds
+ * @param  offset Input offset of the start of the sentence's line
+ */
+void NMEAIndexAdd(NMEAIndexWriter *w, uint32_t ms, uint64_t offset) {
+	uint64_t t = NMEALogClockAdvance(&w->clock, ms);
+	uint8_t entry[16];
+	if(t > w->latest || w->timed == 0)
+		w->latest = t;
+	if(w->timed++ % w->interval != 0)
+		return;
+	Store64LE(entry, w->latest);
+	Store64LE(entry + 8, offset);
+	if(fwrite(entry, 1, sizeof(entry), w->fp) != sizeof(entry))
+		w->error = 1;
+	w->entries++;
+}
+
+/**
+ * NMEAIndexClose
+ * <p>
+ * This function closes an index.
+ * <p>
+ *
+ * @param  w Writer opened by NMEAIndexOpen
+ * @return 0 on success, -1 if the index could not be written completely
+ */
+int NMEAIndexClose(NMEAIndexWriter *w) {
+	if(fclose(w->fp) != 0)
+		w->error = 1;
+	return w->error ? -1 : 0;
+}
+
+/**
+ * NMEAIndexMatches
+ * <p>
+ * This function checks that a mapped index was written for a log as it is now: the
+ * size and the hash of the first block stamped in its header must be the log's.
+ * <p>
+ *
+ * @param  index Index file mapped by NMEAMapFile
+ * @param  data Start of the log
+ * @param  size Size of the log
+ * @return 1 if the index is of this log, 0 if it is stale or not an index
+ */
+int NMEAIndexMatches(const NMEAMappedFile *index, const char *data, size_t size) {
+	if(index->size < NMEA_INDEX_HEADER || memcmp(index->data, NMEA_INDEX_MAGIC, 8) != 0)
+		return 0;
+	return Load64LE(index->data + 16) == size && Load64LE(index->data + 24) == IndexStampHash(data, size);
+}
+
+/**
+ * NMEAIndexSeek
+ * <p>
+ * This function binary searches a mapped index for the last entry earlier than a time,
+ * where parsing must start to see every sentence at or after that time.
+ * <p>
+ *
+ * @param  index Index file mapped by NMEAMapFile
+ * @param  time Time since midnight of the first day of the log in milliseconds
+ * @param  entry Entry to start from; offset 0 and time 0 when there is none
+ * @return 0 on success, -1 if the file is not an index
+ */
+int NMEAIndexSeek(const NMEAMappedFile *index, uint64_t time, NMEAIndexEntry *entry) {
+	size_t lo = 0, hi, mid;
+	if(index->size < NMEA_INDEX_HEADER || memcmp(index->data, NMEA_INDEX_MAGIC, 8) != 0
+		|| (index->size - NMEA_INDEX_HEADER) % 16 != 0)
+		return -1;
+	entry->time = 0;
+	entry->offset = 0;
+	// Find the first entry not earlier than time; the one before it is the answer
+	hi = (index->size - NMEA_INDEX_HEADER) / 16;
+	while(lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if(Load64LE(index->data + NMEA_INDEX_HEADER + 16*mid) < time)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if(lo > 0) {
+		entry->time = Load64LE(index->data + NMEA_INDEX_HEADER + 16*(lo-1));
+		entry->offset = Load64LE(index->data + NMEA_INDEX_HEADER + 16*(lo-1) + 8);
+	}
+	return 0;
+}
+
+/**
+ * NMEAGSVAssemblerInit
+ * <p>
+ * This function prepares an empty GSV cycle assembler.
+ * <p>
+ *
+ * @param  a Assembler to initialize
+ */
+void NMEAGSVAssemblerInit(NMEAGSVAssembler *a) {
+	memset(a, 0, sizeof(*a));
+}
+
+/* Cycle slot of a talker, claiming a free one for a new talker; NULL when all are taken */
+static NMEAGSVCycle *GSVCycleOf(NMEAGSVAssembler *a, const char *talker) {
+	unsigned int i;
+	for(i=0;i<a->talkers;i++)
+		if(a->cycle[i].view.talker[0] == talker[0] && a->cycle[i].view.talker[1] == talker[1])
+			return &a->cycle[i];
+	if(a->talkers == NMEA_GSV_MAX_TALKERS)
+		return NULL;
+	memcpy(a->cycle[a->talkers].view.talker, talker, 2);
+	return &a->cycle[a->talkers++];
+}
+
+/**
+ * NMEAGSVAssemblerPush
+ * <p>
+ * This function adds one decoded GSV message to the cycle of its talker. Message 1
+ * starts a new cycle, discarding one left incomplete; each following message must be
+ * the next one of the same count. The sky view is returned once, with the last
+ * message of the cycle, and stays valid until the next call for that talker.
+ * <p>
+ *
+ * @param  a Assembler initialized by NMEAGSVAssemblerInit
+ * @param  talker Talker ID of the sentence, e.g. "GP"
+ * @param  gsv Message decoded without error
+ * @return Completed sky view, or NULL while the cycle is not complete
+ */
+const NMEASkyView *NMEAGSVAssemblerPush(NMEAGSVAssembler *a, const char *talker, const NMEAGSV *gsv) {
+	NMEAGSVCycle *c = GSVCycleOf(a, talker);
+	NMEASkyView *v;
+	int i, k;
+	if(c == NULL) {
+		a->dropped++;
+		return NULL;
+	}
+	v = &c->view;
+	if(gsv->messageNumber == 1) {
+		if(c->nextMessage != 0)
+			a->discarded++;
+		v->messages = gsv->totalMessages;
+		v->satellitesInView = 0;
+		v->count = 0;
+		c->nextMessage = 1;
+	}
+	if(c->nextMessage == 0)
+		return NULL;
+	if(gsv->messageNumber != c->nextMessage || gsv->totalMessages != v->messages || gsv->messageNumber > gsv->totalMessages) {
+		a->discarded++;
+		c->nextMessage = 0;
+		return NULL;
+	}
+	if(gsv->valid & NMEA_GSV_INVIEW)
+		v->satellitesInView = gsv->satellitesInView;
+	for(i=0;i<NMEA_GSV_SV_PER_MESSAGE;i++) {
+		unsigned int valid = 0;
+		for(k=0;k<4;k++)
+			if(gsv->valid & NMEA_GSV_SV(i,k))
+				valid |= 1u << k;
+		if(valid == 0)
+			continue;
+		v->sv[v->count] = gsv->sv[i];
+		v->svValid[v->count++] = valid;
+	}
+	if(c->nextMessage++ < v->messages)
+		return NULL;
+	c->nextMessage = 0;
+	a->completed++;
+	return v;
+}
+
+/**
+ * NMEAGSVAssemblerFinish
+ * <p>
+ * This function ends the input, counting the cycles still incomplete as discarded.
+ * <p>
+ *
+ * @param  a Assembler initialized by NMEAGSVAssemblerInit
+ */
+void NMEAGSVAssemblerFinish(NMEAGSVAssembler *a) {
+	unsigned int i;
+	for(i=0;i<a->talkers;i++) {
+		if(a->cycle[i].nextMessage != 0)
+			a->discarded++;
+		a->cycle[i].nextMessage = 0;
+	}
+}
+
+/**
+ * NMEAEpochInit
+ * <p>
+ * This function prepares an empty epoch assembler.
+ * <p>
+ *
+ * @param  a Assembler to initialize
+ * @param  expect Sentences that complete an epoch (NMEA_EPOCH_*), 0 for all four
+ * @param  timeout Log time in ms after which an incomplete epoch is emitted
+ */
+void NMEAEpochInit(NMEAEpochAssembler *a, unsigned int expect, uint32_t timeout) {
+	memset(a, 0, sizeof(*a));
+	a->expect = expect ? expect : NMEA_EPOCH_ALL;
+	a->timeout = timeout;
+	a->latest = -1;
+	a->pending = -1;
+}
+
+/* Hands a fix to the handler once, then frees the emitted fixes at the head of the ring */
+static void EpochEmit(NMEAEpochAssembler *a, NMEAFix *fix, NMEAFixHandler handler, void *ctx) {
+	fix->done = 1;
+	handler(ctx, fix);
+	while(a->count > 0 && a->ring[a->head].done) {
+		if((int)a->head == a->latest)
+			a->latest = -1;
+		a->head = (a->head + 1) % NMEA_EPOCH_RING;
+		a->count--;
+	}
+}
+
+/**
+ * NMEAEpochPush
+ * <p>
+ * This function merges a decoded sentence into the fix of its epoch, opening a new one
+ * for a new time. GSA joins the epoch of the latest timed sentence, adding its PRNs to
+ * those of the GSAs of other talkers. Fixes left behind by more than the timeout, and
+ * the oldest one when the ring is full, are emitted first; the fix is emitted as soon
+ * as it has all the expected sentences, or, when a GSA completed it, at the next
+ * sentence that is not a GSA. Sentences of epochs already emitted, and GSA without an
+ * open epoch, are counted as orphans.
+ * <p>
+ *
+ * @param  a Assembler initialized by NMEAEpochInit
+ * @param  s Sentence decoded without error; types other than GGA, GSA, GST and GLL are ignored
+ * @param  handler Called for every fix emitted
+ * @param  ctx Passed on to the handler
+ */
+void NMEAEpochPush(NMEAEpochAssembler *a, const NMEASentence *s, NMEAFixHandler handler, void *ctx) {
+	NMEAFix *fix = NULL;
+	unsigned int bit, i;
+	uint32_t ms;
+	uint64_t key;
+	switch(s->type) {
+		case NMEA_TYPE_GGA:
+			bit = NMEA_EPOCH_GGA;
+			break;
+		case NMEA_TYPE_GSA:
+			bit = NMEA_EPOCH_GSA;
+			break;
+		case NMEA_TYPE_GST:
+			bit = NMEA_EPOCH_GST;
+			break;
+		case NMEA_TYPE_GLL:
+			bit = NMEA_EPOCH_GLL;
+			break;
+		default:
+			return;
+	}
+	if(s->type != NMEA_TYPE_GSA && a->pending >= 0) {
+		fix = &a->ring[a->pending];
+		a->pending = -1;
+		a->complete++;
+		EpochEmit(a, fix, handler, ctx);
+		fix = NULL;
+	}
+	if(s->type == NMEA_TYPE_GSA) {
+		if(a->latest < 0 || a->ring[a->latest].done) {
+			a->orphans++;
+			return;
+		}
+		fix = &a->ring[a->latest];
+	}
+	else {
+		if(!NMEASentenceTime(s, &ms)) {
+			a->orphans++;
+			return;
+		}
+		key = NMEALogClockAdvance(&a->clock, ms);
+		while(a->count > 0 && a->ring[a->head].key + a->timeout < key) {
+			a->incomplete++;
+			EpochEmit(a, &a->ring[a->head], handler, ctx);
+		}
+		for(i=0;i<a->count && fix == NULL;i++)
+			if(a->ring[(a->head + i) % NMEA_EPOCH_RING].key == key)
+				fix = &a->ring[(a->head + i) % NMEA_EPOCH_RING];
+		if(fix != NULL && fix->done) {
+			a->orphans++;
+			return;
+		}
+		if(fix == NULL) {
+			if(a->count == NMEA_EPOCH_RING) {
+				a->evicted++;
+				EpochEmit(a, &a->ring[a->head], handler, ctx);
+			}
+			fix = &a->ring[(a->head + a->count++) % NMEA_EPOCH_RING];
+			memset(fix, 0, sizeof(*fix));
+			fix->key = key;
+			fix->time = ms;
+			memcpy(fix->talker, s->talker, 2);
+		}
+		a->latest = fix - a->ring;
+	}
+	if(memcmp(fix->talker, s->talker, 2) != 0)
+		memcpy(fix->talker, "GN", 2);
+	if(s->type == NMEA_TYPE_GGA)
+		fix->gga = s->u.gga;
+	else if(s->type == NMEA_TYPE_GSA) {
+		if(!(fix->have & NMEA_EPOCH_GSA))
+			fix->gsa = s->u.gsa;
+		for(i=0;i<NMEA_GSA_MAX_PRN && fix->prns < NMEA_FIX_MAX_PRN;i++)
+			if(s->u.gsa.valid & NMEA_GSA_PRN(i))
+				fix->prn[fix->prns++] = s->u.gsa.prn[i];
+	}
+	else if(s->type == NMEA_TYPE_GST)
+		fix->gst = s->u.gst;
+	else
+		fix->gll = s->u.gll;
+	fix->have |= bit;
+	if((fix->have & a->expect) == a->expect && (int)(fix - a->ring) != a->pending) {
+		if(s->type == NMEA_TYPE_GSA)
+			a->pending = fix - a->ring;
+		else {
+			a->complete++;
+			EpochEmit(a, fix, handler, ctx);
+		}
+	}
+}
+
+/**
+ * NMEAEpochFinish
+ * <p>
+ * This function ends the input, emitting the fixes still open from oldest to newest.
+ * <p>
+ *
+ * @param  a Assembler initialized by NMEAEpochInit
+ * @param  handler Called for every fix emitted
+ * @param  ctx Passed on to the handler
+ */
+void NMEAEpochFinish(NMEAEpochAssembler *a, NMEAFixHandler handler, void *ctx) {
+	if(a->pending >= 0) {
+		a->complete++;
+		EpochEmit(a, &a->ring[a->pending], handler, ctx);
+		a->pending = -1;
+	}
+	while(a->count > 0) {
+		a->incomplete++;
+		EpochEmit(a, &a->ring[a->head], handler, ctx);
+	}
+}
+
+static const char *statusStrings[NMEA_STATUS_COUNT] = {
+	"OK",
+	"Wrong format",
+	"Incorrect time format",
+	"Value must be a number",
+	"Value out of range",
+	"Wrong direction",
+	"Wrong unit of measurement",
+	"Invalid value",
+	"Required field not specified",
+	"Terminal '*' missing",
+	"Format not supported",
+	"Checksum mismatch"
+};
+
+/**
+ * NMEAStatusString
+ * <p>
+ * This function returns a human-readable description of a parse status.
+ * <p>
+ *
+ * @param  status Status returned by one of the parsers
+ * @return Static string describing the status
+ */
+const char *NMEAStatusString(NMEAStatus status) {
+	if((unsigned int)status >= NMEA_STATUS_COUNT)
+		return "Unknown status";
+	return statusStrings[status];
+}
+
+/*
+ * Output sinks. Records are formatted into the sink's buffer by hand, without printf,
+ * and the buffer is written out with one write(2) whenever it fills up. The text format
+ * reproduces the human-readable report the parsers used to print while decoding, from
+ * the result structures alone; CSV and NDJSON carry the columns of the Arrow export.
+ */
+
+/* Pairs of decimal digits "00" to "99", for the integer formatter */
+static const char digitPairs[201] =
+	"0001020304050607080910111213141516171819202122232425262728293031323334353637383940414243444546474849"
+	"5051525354555657585960616263646566676869707172737475767778798081828384858687888990919293949596979899";
+
+/* Hands bytes to the destination of the sink: write(2) on fd, or fwrite on fp when fd is -1 */
+static void SinkOutput(NMEASink *s, const char *data, size_t len) {
+	while(len > 0 && !s->error) {
+		ssize_t n;
+		if(s->fd < 0) {
+			if(fwrite(data, 1, len, s->fp) != len)
+				s->error = 1;
+			return;
+		}
+		n = write(s->fd, data, len);
+		if(n < 0 && errno == EINTR)
+			continue;
+		if(n <= 0) {
+			s->error = 1;
+			return;
+		}
+		data += n;
+		len -= n;
+	}
+}
+
+/*
+ * Columns of the CSV format: a single header serves every type, so that the file loads
+ * as one table. It holds the union of the columns of all types by name, in order of
+ * first appearance, which shares columns such as time between types; field[type][i] is
+ * 1 + the column of the type in cell i, or 0 if the type has no such column.
+ */
+#define CSV_MAX_COLUMNS 96
+
+static struct {
+	const char *names[CSV_MAX_COLUMNS];
+	unsigned char field[RECORD_COUNT][CSV_MAX_COLUMNS];
+	unsigned int count;
+} csvLayout;
+
+/* Builds csvLayout once, from the column tables */
+static void CsvLayoutInit(void) {
+	unsigned int t, k, i;
+	if(csvLayout.count > 0)
+		return;
+	for(t=0;t<RECORD_COUNT;t++) {
+		for(k=0;k<columnSchemas[t].count;k++) {
+			for(i=0;i<csvLayout.count;i++)
+				if(strcmp(csvLayout.names[i], columnSchemas[t].columns[k].name) == 0)
+					break;
+			if(i == csvLayout.count)
+				csvLayout.names[csvLayout.count++] = columnSchemas[t].columns[k].name;
+			csvLayout.field[t][i] = k + 1;
+		}
+	}
+}
+
+/**
+ * NMEASinkInit
+ * <p>
+ * This function creates a sink with a buffer of its own.
+ * <p>
+ *
+ * @param  s Sink to initialize
+ * @param  fd Descriptor to write(2) to, or -1 to use fp
+ * @param  fp Stream to write to when fd is -1
+ * @param  format NMEA_FORMAT_TEXT, NMEA_FORMAT_CSV or NMEA_FORMAT_NDJSON
+ * @param  size Buffer size, 0 for NMEA_SINK_SIZE
+ * @return 0 on success, -1 if the buffer could not be allocated
+ */
+int NMEASinkInit(NMEASink *s, int fd, FILE *fp, int format, size_t size) {
+	memset(s, 0, sizeof(*s));
+	s->fd = fd;
+	s->fp = fp;
+	s->format = format;
+	s->size = size == 0 ? NMEA_SINK_SIZE : size < 256 ? 256 : size;
+	if(format == NMEA_FORMAT_CSV)
+		CsvLayoutInit();
+	if((s->buf = malloc(s->size)) == NULL)
+		return -1;
+	return 0;
+}
+
+/* Sink over a caller's buffer that flushes to a stdio stream, for the FILE based printers */
+static void SinkOnStream(NMEASink *s, FILE *fp, char *buf, size_t size) {
+	memset(s, 0, sizeof(*s));
+	s->fd = -1;
+	s->fp = fp;
+	s->buf = buf;
+	s->size = size;
+}
+
+/**
+ * NMEASinkFlush
+ * <p>
+ * This function writes out whatever the buffer holds.
+ * <p>
+ *
+ * @param  s Sink
+ * @return 0 on success, -1 if anything written to the sink so far could not be written out
+ */
+int NMEASinkFlush(NMEASink *s) {
+	SinkOutput(s, s->buf, s->len);
+	s->len = 0;
+	return s->error ? -1 : 0;
+}
+
+/**
+ * NMEASinkClose
+ * <p>
+ * This function flushes a sink created by NMEASinkInit and frees its buffer.
+ * <p>
+ *
+ * @param  s Sink
+ * @return 0 on success, -1 if anything written to the sink could not be written out
+ */
+int NMEASinkClose(NMEASink *s) {
+	int ret = NMEASinkFlush(s);
+	free(s->buf);
+	s->buf = NULL;
+	return ret;
+}
+
+/**
+ * NMEASinkWrite
+ * <p>
+ * This function appends raw bytes; blocks larger than the buffer bypass it.
+ * <p>
+ *
+ * @param  s Sink
+ * @param  data Bytes to append
+ * @param  len Number of bytes
+ */
+void NMEASinkWrite(NMEASink *s, const char *data, size_t len) {
+	if(s->len + len > s->size) {
+		NMEASinkFlush(s);
+		if(len > s->size) {
+			SinkOutput(s, data, len);
+			return;
+		}
+	}
+	memcpy(s->buf + s->len, data, len);
+	s->len += len;
+}
+
+/* Room for n more bytes, n being at most a few dozen */
+static inline char *SinkReserve(NMEASink *s, size_t n) {
+	if(s->len + n > s->size)
+		NMEASinkFlush(s);
+	return s->buf + s->len;
+}
+
+static inline void SinkPutChar(NMEASink *s, char c) {
+	*SinkReserve(s, 1) = c;
+	s->len++;
+}
+
+static inline void SinkPutString(NMEASink *s, const char *str) {
+	NMEASinkWrite(s, str, strlen(str));
+}
+
+/* Unsigned decimal zero-padded to at least 'width' digits, like %0<width>u */
+static void SinkPutUint(NMEASink *s, uint32_t v, unsigned int width) {
+	char digits[10], *p = digits + sizeof(digits);
+	size_t n;
+	while(v >= 100) {
+		p -= 2;
+		memcpy(p, digitPairs + 2*(v % 100), 2);
+		v /= 100;
+	}
+	if(v >= 10) {
+		p -= 2;
+		memcpy(p, digitPairs + 2*v, 2);
+	}
+	else
+		*--p = '0' + v;
+	while(p > digits && (unsigned int)(digits + sizeof(digits) - p) < width)
+		*--p = '0';
+	n = digits + sizeof(digits) - p;
+	memcpy(SinkReserve(s, n), p, n);
+	s->len += n;
+}
+
+/* Signed decimal like %0<width>d, the sign counting towards the width */
+static void SinkPutInt(NMEASink *s, int32_t v, unsigned int width) {
+	if(v >= 0) {
+		SinkPutUint(s, v, width);
+		return;
+	}
+	SinkPutChar(s, '-');
+	SinkPutUint(s, -(uint32_t)v, width > 1 ? width - 1 : 0);
+}
+
+/* Fixed-point value with 'scale' fraction digits, keeping at least 'digits' of them like %.<digits>f */
+static void SinkPutFixed(NMEASink *s, int32_t v, unsigned int scale, unsigned int digits) {
+	uint32_t mag = v < 0 ? -(uint32_t)v : (uint32_t)v;
+	uint32_t frac = mag % powersOf10[scale];
+	if(v < 0)
+		SinkPutChar(s, '-');
+	SinkPutUint(s, mag / powersOf10[scale], 0);
+	while(scale > digits && frac % 10 == 0) {
+		frac /= 10;
+		scale--;
+	}
+	if(scale > 0) {
+		SinkPutChar(s, '.');
+		SinkPutUint(s, frac, scale);
+	}
+}
+
+/* Time of day as hh:mm:ss.sss, leaving out the milliseconds of a whole second if 'trim' */
+static void SinkPutClock(NMEASink *s, uint32_t ms, int trim) {
+	SinkPutUint(s, ms/3600000, 2);
+	SinkPutChar(s, ':');
+	SinkPutUint(s, ms/60000%60, 2);
+	SinkPutChar(s, ':');
+	SinkPutUint(s, ms/1000%60, 2);
+	if(!trim || ms%1000 != 0) {
+		SinkPutChar(s, '.');
+		SinkPutUint(s, ms%1000, 3);
+	}
+}
+
+static void TextTime(NMEASink *s, uint32_t ms) {
+	SinkPutString(s, "Fix taken at ");
+	SinkPutClock(s, ms, 1);
+	SinkPutString(s, " UTC\n");
+}
+
+/*
+ * "<name>: <degrees> deg <minutes>' <hemisphere>". 1e-7 degrees are 6e-6 minutes, so the
+ * minutes are rounded to 1e-5, which may carry into the degrees, and keep at least three
+ * decimals.
+ */
+static void TextCoord(NMEASink *s, const char *name, int32_t c, char hemisphere) {
+	uint32_t mag = c < 0 ? -(uint32_t)c : (uint32_t)c;
+	uint32_t deg = mag / 10000000, minutes = ((mag % 10000000)*6 + 5) / 10;
+	if(minutes == 6000000) {
+		deg++;
+		minutes = 0;
+	}
+	SinkPutString(s, name);
+	SinkPutString(s, ": ");
+	SinkPutUint(s, deg, 0);
+	SinkPutString(s, " deg ");
+	SinkPutFixed(s, minutes, 5, 3);
+	SinkPutString(s, "' ");
+	SinkPutChar(s, hemisphere);
+	SinkPutChar(s, '\n');
+}
+
+/* "<label><fixed-point value><unit>", the value with at least 'digits' decimals */
+static void TextFixed(NMEASink *s, const char *label, int32_t v, unsigned int scale, unsigned int digits, const char *unit) {
+	SinkPutString(s, label);
+	SinkPutFixed(s, v, scale, digits);
+	SinkPutString(s, unit);
+}
+
+/* "<label><integer>\n" */
+static void TextInt(NMEASink *s, const char *label, int32_t v, unsigned int width) {
+	SinkPutString(s, label);
+	SinkPutInt(s, v, width);
+	SinkPutChar(s, '\n');
+}
+
+/* "<lead>**********<before><talker><type><after>**********\n" */
+static void TextBanner(NMEASink *s, const char *lead, const char *before, const char *talker, const char *type, const char *after) {
+	SinkPutString(s, lead);
+	SinkPutString(s, "**********");
+	SinkPutString(s, before);
+	SinkPutString(s, talker);
+	SinkPutString(s, type);
+	SinkPutString(s, after);
+	SinkPutString(s, "**********\n");
+}
+
+static void TextNotSpecified(NMEASink *s, const char *name, const char *suffix) {
+	SinkPutString(s, name);
+	SinkPutString(s, suffix);
+	SinkPutString(s, " not specified\n");
+}
+
+static void TextResult(NMEASink *s, const char *talker, const char *type, const char **fieldNames, unsigned int nFields,
+		unsigned int fieldsRead, NMEAStatus status) {
+	if(status == NMEA_OK) {
+		TextBanner(s, "\n", "", talker, type, " format string parsing complete");
+		return;
+	}
+	SinkPutString(s, "Not valid ");
+	SinkPutString(s, talker);
+	SinkPutString(s, type);
+	if(fieldsRead < nFields && status != NMEA_ERR_CHECKSUM) {
+		SinkPutString(s, " sentence. ");
+		SinkPutString(s, fieldNames[fieldsRead]);
+		SinkPutString(s, ": ");
+	}
+	else
+		SinkPutString(s, " sentence format. ");
+	SinkPutString(s, NMEAStatusString(status));
+	SinkPutChar(s, '\n');
+}
+
+static const char *ggaFieldNames[] = {
+	"Fix time", "Latitude", "Longitude", "Fix Quality", "Number of Satellites", "HDOP",
+	"Altitude", "Height of geoid", "Time since last DGPS update", "Differential reference station ID"
+};
+
+static const char *ggaQuality[] = { "Invalid Fix", "GPS Fix", "DGPS Fix" };
+
+static void TextGGA(NMEASink *s, const char *talker, const NMEAGGA *gga, NMEAStatus status) {
+	unsigned int i;
+	TextBanner(s, "\n\n", "Parsing ", talker, "GGA", " input string");
+	SinkPutChar(s, '\n');
+	for(i=0;i<gga->fieldsRead;i++) {
+		if(!(gga->valid & (1u<<i))) {
+			TextNotSpecified(s, ggaFieldNames[i], i==9 ? " " : "");
+			continue;
+		}
+		switch(1u<<i) {
+			case NMEA_GGA_TIME:
+				TextTime(s, gga->time);
+				break;
+			case NMEA_GGA_LAT:
+				TextCoord(s, "latitude", gga->lat, gga->latDir);
+				break;
+			case NMEA_GGA_LON:
+				TextCoord(s, "longitude", gga->lon, gga->lonDir);
+				break;
+			case NMEA_GGA_QUALITY:
+				SinkPutString(s, "Quality of fix: '");
+				SinkPutString(s, ggaQuality[gga->quality]);
+				SinkPutString(s, "'\n");
+				break;
+			case NMEA_GGA_SATS:
+				TextInt(s, "Number of satellites being tracked: ", gga->satellites, 0);
+				break;
+			case NMEA_GGA_HDOP:
+				TextFixed(s, "Horizontal dilution of position (HDOP): ", gga->hdop, 2, 1, "\n");
+				break;
+			case NMEA_GGA_ALT:
+				TextFixed(s, "Altitude (m) above mean sea level: ", gga->altitude, 3, 1, "\n");
+				break;
+			case NMEA_GGA_GEOID:
+				TextFixed(s, "Height of geoid (m) above WGS84 ellipsoid: ", gga->geoidHeight, 3, 1, "\n");
+				break;
+			case NMEA_GGA_DGPS_AGE:
+				TextInt(s, "Time since last DGPS update: ", gga->dgpsAge, 0);
+				break;
+			case NMEA_GGA_DGPS_STATION:
+				TextInt(s, "Differential reference station ID : ", gga->dgpsStation, 0);
+				break;
+		}
+	}
+	TextResult(s, talker, "GGA", ggaFieldNames, 10, gga->fieldsRead, status);
+}
+
+static const char *gsaFieldNames[] = {
+	"Mode Selection", "Fix type",
+	"PRN of Satellite # 0", "PRN of Satellite # 1", "PRN of Satellite # 2", "PRN of Satellite # 3",
+	"PRN of Satellite # 4", "PRN of Satellite # 5", "PRN of Satellite # 6", "PRN of Satellite # 7",
+	"PRN of Satellite # 8", "PRN of Satellite # 9", "PRN of Satellite # 10", "PRN of Satellite # 11",
+	"PDOP", "HDOP", "VDOP"
+};
+
+static void TextGSA(NMEASink *s, const char *talker, const NMEAGSA *gsa, NMEAStatus status) {
+	static const char *fixType[] = { "", "No fix", "2D fix", "3D fix" };
+	unsigned int i;
+	TextBanner(s, "\n\n", "Parsing ", talker, "GSA", " input string");
+	SinkPutChar(s, '\n');
+	for(i=0;i<gsa->fieldsRead;i++) {
+		if(!(gsa->valid & (1u<<i))) {
+			TextNotSpecified(s, gsaFieldNames[i], (i>=2 && i<14) ? " :" : "");
+			continue;
+		}
+		if(i==0)
+			SinkPutString(s, gsa->mode == 'A' ? "Mode: Auto selection\n" : "Mode: Manual Selection\n");
+		else if(i==1) {
+			SinkPutString(s, "Fix Type: '");
+			SinkPutString(s, fixType[gsa->fixType]);
+			SinkPutString(s, "'\n");
+		}
+		else if(i<14) {
+			SinkPutString(s, "PRN of Satellite # ");
+			SinkPutUint(s, i-2, 0);
+			TextInt(s, " : ", gsa->prn[i-2], 2);
+		}
+		else if(i==14)
+			TextFixed(s, "PDOP: ", gsa->pdop, 2, 1, "\n");
+		else if(i==15)
+			TextFixed(s, "HDOP: ", gsa->hdop, 2, 1, "\n");
+		else
+			TextFixed(s, "VDOP: ", gsa->vdop, 2, 1, "\n");
+	}
+	TextResult(s, talker, "GSA", gsaFieldNames, 17, gsa->fieldsRead, status);
+}
+
+static const char *gllFieldNames[] = { "Latitude", "Longitude", "Fix time", "Status" };
+
+static void TextGLL(NMEASink *s, const char *talker, const NMEAGLL *gll, NMEAStatus status) {
+	unsigned int i;
+	TextBanner(s, "\n", "Parsing ", talker, "GLL", " input string");
+	SinkPutChar(s, '\n');
+	for(i=0;i<gll->fieldsRead;i++) {
+		if(!(gll->valid & (1u<<i))) {
+			TextNotSpecified(s, gllFieldNames[i], "");
+			continue;
+		}
+		switch(1u<<i) {
+			case NMEA_GLL_LAT:
+				TextCoord(s, "latitude", gll->lat, gll->latDir);
+				break;
+			case NMEA_GLL_LON:
+				TextCoord(s, "longitude", gll->lon, gll->lonDir);
+				break;
+			case NMEA_GLL_TIME:
+				TextTime(s, gll->time);
+				break;
+			case NMEA_GLL_STATUS:
+				SinkPutString(s, gll->status == 'A' ? "Status: Data Valid\n" : "Status: Void\n");
+				break;
+		}
+	}
+	TextResult(s, talker, "GLL", gllFieldNames, 4, gll->fieldsRead, status);
+}
+
+static const char *gsvFieldNames[] = {
+	"Total number of messages", "Message number", "Number of Satellites",
+	"PRN number Satellite # 0", "Elevation for satellite # 0", "Azimuth for satellite # 0", "SNR for satellite # 0",
+	"PRN number Satellite # 1", "Elevation for satellite # 1", "Azimuth for satellite # 1", "SNR for satellite # 1",
+	"PRN number Satellite # 2", "Elevation for satellite # 2", "Azimuth for satellite # 2", "SNR for satellite # 2",
+	"PRN number Satellite # 3", "Elevation for satellite # 3", "Azimuth for satellite # 3", "SNR for satellite # 3"
+};
+
+static void TextGSV(NMEASink *s, const char *talker, const NMEAGSV *gsv, NMEAStatus status) {
+	static const char *svLabel[][2] = {
+		{ "PRN number Satellite # ", ": " },
+		{ "Elevation for satellite (in degrees) # ", " : " },
+		{ "Azimuth for satellite (degrees from True North) # ", " : " },
+		{ "SNR for satellite # ", " : " }
+	};
+	static const unsigned int svWidth[] = { 2, 2, 3, 2 };
+	unsigned int i;
+	TextBanner(s, "\n\n", "Parsing ", talker, "GSV", " input string");
+	SinkPutChar(s, '\n');
+	for(i=0;i<gsv->fieldsRead;i++) {
+		if(i<3 && !(gsv->valid & (1u<<i))) {
+			TextNotSpecified(s, gsvFieldNames[i], "");
+			continue;
+		}
+		if(i==0)
+			TextInt(s, "Total number of messages of this type in this cycle: ", gsv->totalMessages, 0);
+		else if(i==1)
+			TextInt(s, "Message number: ", gsv->messageNumber, 0);
+		else if(i==2)
+			TextInt(s, "Number of satellites being tracked: ", gsv->satellitesInView, 0);
+		else {
+			unsigned int sat = (i-3)/4, k = (i-3)%4;
+			const NMEASatellite *sv = &gsv->sv[sat];
+			int value = k==0 ? sv->prn : k==1 ? sv->elevation : k==2 ? sv->azimuth : sv->snr;
+			if(k==0) {
+				SinkPutString(s, "Information about SV # ");
+				SinkPutUint(s, sat, 0);
+				SinkPutChar(s, '\n');
+			}
+			SinkPutChar(s, '\t');
+			SinkPutString(s, svLabel[k][0]);
+			SinkPutUint(s, sat, 0);
+			SinkPutString(s, svLabel[k][1]);
+			if(gsv->valid & NMEA_GSV_SV(sat,k))
+				TextInt(s, "", value, svWidth[k]);
+			else
+				SinkPutString(s, "not specified\n");
+		}
+	}
+	TextResult(s, talker, "GSV", gsvFieldNames, 19, gsv->fieldsRead, status);
+}
+
+static const char *gstFieldNames[] = {
+	"Fix time", "RMS value of the pseudorange residuals",
+	"Error ellipse semi-major axis 1 sigma error", "Error ellipse semi-minor axis 1 sigma error",
+	"Error ellipse orientation", "Latitude 1 sigma error", "Longitude 1 sigma error", "Height 1 sigma error"
+};
+
+static void TextGST(NMEASink *s, const char *talker, const NMEAGST *gst, NMEAStatus status) {
+	unsigned int i;
+	TextBanner(s, "\n\n", "Parsing ", talker, "GST", " input string");
+	SinkPutChar(s, '\n');
+	for(i=0;i<gst->fieldsRead;i++) {
+		if(!(gst->valid & (1u<<i))) {
+			TextNotSpecified(s, gstFieldNames[i], "");
+			continue;
+		}
+		switch(1u<<i) {
+			case NMEA_GST_TIME:
+				TextTime(s, gst->time);
+				break;
+			case NMEA_GST_RMS:
+				TextFixed(s, "RMS value of the pseudorange residuals: ", gst->rms, 3, 3, "\n");
+				break;
+			case NMEA_GST_SEMI_MAJOR:
+				TextFixed(s, "Error ellipse semi-major axis 1 sigma error: ", gst->semiMajor, 3, 3, " m\n");
+				break;
+			case NMEA_GST_SEMI_MINOR:
+				TextFixed(s, "Error ellipse semi-minor axis 1 sigma error: ", gst->semiMinor, 3, 3, " m\n");
+				break;
+			case NMEA_GST_ORIENTATION:
+				TextFixed(s, "Error ellipse orientation (degrees from true north): ", gst->orientation, 2, 1, "\n");
+				break;
+			case NMEA_GST_SIGMA_LAT:
+				TextFixed(s, "Latitude 1 sigma error (m): ", gst->sigmaLat, 3, 3, "\n");
+				break;
+			case NMEA_GST_SIGMA_LON:
+				TextFixed(s, "Longitude 1 sigma error (m): ", gst->sigmaLon, 3, 3, "\n");
+				break;
+			case NMEA_GST_SIGMA_ALT:
+				TextFixed(s, "Height 1 sigma error (m): ", gst->sigmaAlt, 3, 3, "\n");
+				break;
+		}
+	}
+	TextResult(s, talker, "GST", gstFieldNames, 8, gst->fieldsRead, status);
+}
+
+static void TextSentence(NMEASink *s, const NMEASentence *sentence, NMEAStatus status) {
+	switch(sentence->type) {
+#define TEXT_CASE(NAME, member, ...) \
+		case NMEA_TYPE_##NAME: \
+			Text##NAME(s, sentence->talker, &sentence->u.member, status); \
+			break;
+		NMEA_SENTENCE_TYPES(TEXT_CASE)
+		default:
+			SinkPutString(s, NMEAStatusString(status));
+			break;
+	}
+}
+
+static void TextSkyView(NMEASink *s, const NMEASkyView *view) {
+	static const char *svLabel[] = { "\tPRN number: ", "\tElevation (in degrees): ", "\tAzimuth (degrees from True North): ", "\tSNR: " };
+	static const unsigned int svWidth[] = { 2, 2, 3, 2 };
+	unsigned int i, k;
+	SinkPutString(s, "\n\n**********Assembling ");
+	SinkPutString(s, view->talker);
+	SinkPutString(s, "GSV cycle of ");
+	SinkPutUint(s, view->messages, 0);
+	SinkPutString(s, " messages**********\n\n");
+	TextInt(s, "Number of satellites being tracked: ", view->satellitesInView, 0);
+	for(i=0;i<view->count;i++) {
+		const NMEASatellite *sv = &view->sv[i];
+		SinkPutString(s, "Information about satellite # ");
+		SinkPutUint(s, i, 0);
+		SinkPutChar(s, '\n');
+		for(k=0;k<4;k++) {
+			if(view->svValid[i] & (1u<<k))
+				TextInt(s, svLabel[k], k==0 ? sv->prn : k==1 ? sv->elevation : k==2 ? sv->azimuth : sv->snr, svWidth[k]);
+			else {
+				SinkPutString(s, svLabel[k]);
+				SinkPutString(s, "not specified\n");
+			}
+		}
+	}
+	TextBanner(s, "\n", "", view->talker, "GSV", " sky view complete");
+}
+
+static void TextFix(NMEASink *s, const NMEAFix *fix) {
+	static const char *names[] = { " GGA", " GSA", " GST", " GLL" };
+	const NMEAGGA *gga = fix->have & NMEA_EPOCH_GGA ? &fix->gga : NULL;
+	const NMEAGLL *gll = fix->have & NMEA_EPOCH_GLL ? &fix->gll : NULL;
+	const NMEAGSA *gsa = fix->have & NMEA_EPOCH_GSA ? &fix->gsa : NULL;
+	const NMEAGST *gst = fix->have & NMEA_EPOCH_GST ? &fix->gst : NULL;
+	unsigned int i;
+	TextBanner(s, "\n\n", "Assembling ", fix->talker, "", " epoch");
+	SinkPutChar(s, '\n');
+	TextTime(s, fix->time);
+	SinkPutString(s, "Sentences merged:");
+	for(i=0;i<4;i++)
+		if(fix->have & (1u<<i))
+			SinkPutString(s, names[i]);
+	SinkPutChar(s, '\n');
+	if(gga != NULL && (gga->valid & NMEA_GGA_LAT))
+		TextCoord(s, "latitude", gga->lat, gga->latDir);
+	else if(gll != NULL && (gll->valid & NMEA_GLL_LAT))
+		TextCoord(s, "latitude", gll->lat, gll->latDir);
+	if(gga != NULL && (gga->valid & NMEA_GGA_LON))
+		TextCoord(s, "longitude", gga->lon, gga->lonDir);
+	else if(gll != NULL && (gll->valid & NMEA_GLL_LON))
+		TextCoord(s, "longitude", gll->lon, gll->lonDir);
+	if(gga != NULL && (gga->valid & NMEA_GGA_QUALITY)) {
+		SinkPutString(s, "Quality of fix: '");
+		SinkPutString(s, ggaQuality[gga->quality]);
+		SinkPutString(s, "'\n");
+	}
+	if(gga != NULL && (gga->valid & NMEA_GGA_ALT))
+		TextFixed(s, "Altitude (m) above mean sea level: ", gga->altitude, 3, 1, "\n");
+	if(gga != NULL && (gga->valid & NMEA_GGA_SATS))
+		TextInt(s, "Number of satellites being tracked: ", gga->satellites, 0);
+	if(gsa != NULL) {
+		SinkPutString(s, "PRN of satellites used:");
+		for(i=0;i<fix->prns;i++) {
+			SinkPutChar(s, ' ');
+			SinkPutInt(s, fix->prn[i], 2);
+		}
+		SinkPutChar(s, '\n');
+		if(gsa->valid & NMEA_GSA_PDOP)
+			TextFixed(s, "PDOP: ", gsa->pdop, 2, 1, "\n");
+		if(gsa->valid & NMEA_GSA_HDOP)
+			TextFixed(s, "HDOP: ", gsa->hdop, 2, 1, "\n");
+		if(gsa->valid & NMEA_GSA_VDOP)
+			TextFixed(s, "VDOP: ", gsa->vdop, 2, 1, "\n");
+	}
+	else if(gga != NULL && (gga->valid & NMEA_GGA_HDOP))
+		TextFixed(s, "HDOP: ", gga->hdop, 2, 1, "\n");
+	if(gst != NULL && (gst->valid & NMEA_GST_SIGMA_LAT))
+		TextFixed(s, "Latitude 1 sigma error (m): ", gst->sigmaLat, 3, 3, "\n");
+	if(gst != NULL && (gst->valid & NMEA_GST_SIGMA_LON))
+		TextFixed(s, "Longitude 1 sigma error (m): ", gst->sigmaLon, 3, 3, "\n");
+	if(gst != NULL && (gst->valid & NMEA_GST_SIGMA_ALT))
+		TextFixed(s, "Height 1 sigma error (m): ", gst->sigmaAlt, 3, 3, "\n");
+	TextBanner(s, "\n", "", fix->talker, "", " epoch assembly complete");
+}
+
+/* One column value: integers as they are, times as hh:mm:ss.sss, quoted in JSON with characters */
+static void SinkPutColumn(NMEASink *s, int kind, int32_t v, int quote) {
+	if(kind == COLUMN_INT32) {
+		SinkPutInt(s, v, 0);
+		return;
+	}
+	if(quote)
+		SinkPutChar(s, '"');
+	if(kind == COLUMN_TIME)
+		SinkPutClock(s, v, 0);
+	else
+		SinkPutChar(s, (char)v);
+	if(quote)
+		SinkPutChar(s, '"');
+}
+
+/* "type,talker[,source],columns..." with the union of the columns of every type, see CsvLayoutInit */
+static void CsvHeader(NMEASink *s) {
+	unsigned int i;
+	s->header = 1;
+	SinkPutString(s, s->sources ? "type,talker,source" : "type,talker");
+	for(i=0;i<csvLayout.count;i++) {
+		SinkPutChar(s, ',');
+		SinkPutString(s, csvLayout.names[i]);
+	}
+	SinkPutChar(s, '\n');
+}
+
+/* A list column: the items separated by spaces in CSV, a JSON array in NDJSON */
+static void SinkPutList(NMEASink *s, const int32_t *items, unsigned int count, int json) {
+	unsigned int i;
+	if(json)
+		SinkPutChar(s, '[');
+	for(i=0;i<count;i++) {
+		if(i > 0)
+			SinkPutChar(s, json ? ',' : ' ');
+		SinkPutInt(s, items[i], 0);
+	}
+	if(json)
+		SinkPutChar(s, ']');
+}
+
+/*
+ * CSV row "type,talker[,source],cells..." of a record (a sentence type or RECORD_*), with
+ * empty cells for empty fields and for the columns of other records. v holds the
+ * record's values, followed by the items of its list column if it has one.
+ */
+static void CsvRecord(NMEASink *s, unsigned int record, const char *talker, unsigned int source,
+		const int32_t *v, unsigned int valid) {
+	const ColumnSpec *columns = columnSchemas[record].columns;
+	const unsigned char *field = csvLayout.field[record];
+	unsigned int i, k;
+	if(!s->header)
+		CsvHeader(s);
+	SinkPutString(s, columnSchemas[record].name);
+	SinkPutChar(s, ',');
+	NMEASinkWrite(s, talker, 2);
+	if(s->sources) {
+		SinkPutChar(s, ',');
+		SinkPutUint(s, source, 0);
+	}
+	for(i=0;i<csvLayout.count;i++) {
+		SinkPutChar(s, ',');
+		if(field[i] == 0 || !((valid >> (k = field[i] - 1)) & 1))
+			continue;
+		if(columns[k].kind == COLUMN_LIST)
+			SinkPutList(s, v + columnSchemas[record].count, v[k], 0);
+		else
+			SinkPutColumn(s, columns[k].kind, v[k], 0);
+	}
+	SinkPutChar(s, '\n');
+}
+
+/* NDJSON object with the same members as the CSV columns of the record, null for empty fields; no value needs escaping */
+static void JsonRecord(NMEASink *s, unsigned int record, const char *talker, unsigned int source,
+		const int32_t *v, unsigned int valid) {
+	const ColumnSpec *columns = columnSchemas[record].columns;
+	unsigned int k;
+	SinkPutString(s, "{\"type\":\"");
+	SinkPutString(s, columnSchemas[record].name);
+	SinkPutString(s, "\",\"talker\":\"");
+	NMEASinkWrite(s, talker, 2);
+	SinkPutChar(s, '"');
+	if(s->sources) {
+		SinkPutString(s, ",\"source\":");
+		SinkPutUint(s, source, 0);
+	}
+	for(k=0;k<columnSchemas[record].count;k++) {
+		SinkPutString(s, ",\"");
+		SinkPutString(s, columns[k].name);
+		SinkPutString(s, "\":");
+		if(!((valid >> k) & 1))
+			SinkPutString(s, "null");
+		else if(columns[k].kind == COLUMN_LIST)
+			SinkPutList(s, v + columnSchemas[record].count, v[k], 1);
+		else
+			SinkPutColumn(s, columns[k].kind, v[k], 1);
+	}
+	SinkPutString(s, "}\n");
+}
+
+/* One record in the CSV or NDJSON format of the sink */
+static void SinkRecord(NMEASink *s, unsigned int record, const char *talker, unsigned int source,
+		const int32_t *v, unsigned int valid) {
+	if(s->format == NMEA_FORMAT_CSV)
+		CsvRecord(s, record, talker, source, v, valid);
+	else
+		JsonRecord(s, record, talker, source, v, valid);
+}
+
+/**
+ * NMEASinkSentence
+ * <p>
+ * This function writes one decoded sentence in the format of the sink. The text format
+ * reports every sentence with its status; CSV and NDJSON carry only the sentences
+ * decoded without error, one row or object per line.
+ * <p>
+ *
+ * @param  s Sink
+ * @param  sentence Decoded sentence
+ * @param  status Status returned by the parser
+ */
+void NMEASinkSentence(NMEASink *s, const NMEASentence *sentence, NMEAStatus status) {
+	if(s->format == NMEA_FORMAT_TEXT) {
+		if(s->sources)
+			TextInt(s, "\nSource: ", sentence->source, 0);
+		TextSentence(s, sentence, status);
+		SinkPutChar(s, '\n');
+	}
+	else if(status == NMEA_OK && sentence->type != NMEA_TYPE_UNKNOWN) {
+		int32_t v[NMEA_MAX_COLUMNS];
+		unsigned int valid;
+		SentenceValues(sentence, v, &valid);
+		SinkRecord(s, sentence->type, sentence->talker, sentence->source, v, valid);
+	}
+}
+
+/**
+ * NMEASinkInvalid
+ * <p>
+ * This function reports a line rejected before decoding; only the text format has a
+ * record for it.
+ * <p>
+ *
+ * @param  s Sink
+ * @param  line Sanitized line
+ * @param  len Length of the line
+ * @param  errorLoc Position of the error after the address field
+ * @param  source ID of the input stream the line came from
+ */
+void NMEASinkInvalid(NMEASink *s, const char *line, size_t len, int errorLoc, unsigned int source) {
+	if(s->format != NMEA_FORMAT_TEXT)
+		return;
+	if(s->sources)
+		TextInt(s, "\nSource: ", source, 0);
+	SinkPutString(s, "\nInvalid Input \n");
+	NMEASinkWrite(s, line, len);
+	TextInt(s, "\nError Found at location :", errorLoc + 7, 0);
+	SinkPutChar(s, '\n');
+}
+
+/**
+ * NMEASinkSkyView
+ * <p>
+ * This function writes the report of a complete GSV cycle: in CSV and NDJSON, one SKY
+ * record per satellite.
+ * <p>
+ *
+ * @param  s Sink
+ * @param  view Sky view returned by NMEAGSVAssemblerPush
+ */
+void NMEASinkSkyView(NMEASink *s, const NMEASkyView *view) {
+	int32_t v[RECORD_MAX_VALUES];
+	unsigned int i, valid;
+	if(s->format == NMEA_FORMAT_TEXT) {
+		TextSkyView(s, view);
+		SinkPutChar(s, '\n');
+		return;
+	}
+	for(i=0;i<view->count;i++) {
+		SkyValues(view, i, v, &valid);
+		SinkRecord(s, RECORD_SKY, view->talker, 0, v, valid);
+	}
+}
+
+/**
+ * NMEASinkFix
+ * <p>
+ * This function writes the report of an assembled epoch: in CSV and NDJSON, one FIX
+ * record.
+ * <p>
+ *
+ * @param  s Sink
+ * @param  fix Fix emitted by the epoch assembler
+ */
+void NMEASinkFix(NMEASink *s, const NMEAFix *fix) {
+	int32_t v[RECORD_MAX_VALUES];
+	unsigned int valid;
+	if(s->format == NMEA_FORMAT_TEXT) {
+		TextFix(s, fix);
+		SinkPutChar(s, '\n');
+		return;
+	}
+	FixValues(fix, v, &valid);
+	SinkRecord(s, RECORD_FIX, fix->talker, 0, v, valid);
+}
+
+/*
+ * Printing consumers for stdio streams. Each formats its report with the text sink
+ * through a small buffer on the stack.
+ */
+#define PRINT_BUFFER_SIZE 1024
+
+#define PRINTER(NAME, member, ...) \
+	void PrintGP##NAME(FILE *out, const char *talker, const NMEA##NAME *member, NMEAStatus status) { \
+		char buf[PRINT_BUFFER_SIZE]; \
+		NMEASink s; \
+		SinkOnStream(&s, out, buf, sizeof(buf)); \
+		Text##NAME(&s, talker, member, status); \
+		NMEASinkFlush(&s); \
+	}
+
+/**
+ * PrintGPGGA, PrintGPGSA, ...
+ * <p>
+ * These functions, one per sentence type, print a decoded sentence of their type from
+ * any talker.
+ * <p>
+ *
+ * @param  out Stream the report is written to
+ * @param  talker Talker ID of the sentence, e.g. "GP"
+ * @param  member Decoded sentence, named after its NMEASentence member (gga, gsa, ...)
+ * @param  status Status returned by the type's parser
+ */
+NMEA_SENTENCE_TYPES(PRINTER)
+
+/**
+ * NMEAPrintSkyView
+ * <p>
+ * This function prints the satellites of a complete GSV cycle.
+ * <p>
+ *
+ * @param  out Stream the report is written to
+ * @param  view Sky view returned by NMEAGSVAssemblerPush
+ */
+void NMEAPrintSkyView(FILE *out, const NMEASkyView *view) {
+	char buf[PRINT_BUFFER_SIZE];
+	NMEASink s;
+	SinkOnStream(&s, out, buf, sizeof(buf));
+	TextSkyView(&s, view);
+	NMEASinkFlush(&s);
+}
+
+/**
+ * NMEAPrintFix
+ * <p>
+ * This function prints the fix of an epoch: position and quality from GGA (GLL when
+ * there was no GGA), satellites used and DOPs from GSA, and error estimates from GST.
+ * <p>
+ *
+ * @param  out Stream the report is written to
+ * @param  fix Fix emitted by the epoch assembler
+ */
+void NMEAPrintFix(FILE *out, const NMEAFix *fix) {
+	char buf[PRINT_BUFFER_SIZE];
+	NMEASink s;
+	SinkOnStream(&s, out, buf, sizeof(buf));
+	TextFix(&s, fix);
+	NMEASinkFlush(&s);
+}
+
+/**
+ * NMEAPrintSentence
+ * <p>
+ * This function prints any decoded sentence using the printer for its type.
+ * <p>
+ *
+ * @param  out Stream the report is written to
+ * @param  s Decoded sentence
+ * @param  status Status returned by NMEAParseSentence
+ */
+void NMEAPrintSentence(FILE *out, const NMEASentence *s, NMEAStatus status) {
+	char buf[PRINT_BUFFER_SIZE];
+	NMEASink sink;
+	SinkOnStream(&sink, out, buf, sizeof(buf));
+	TextSentence(&sink, s, status);
+	NMEASinkFlush(&sink);
+}
+
+/**
+ * ReadLineFromFile                          
+ * <p>
+ * This function is used to read one line from the input file from current position of file pointer.
+ * <p> 
+ * 
+ * @param  fp File pointer pointing to current location in file
+ * @param  line Data read from file is copied into this buffer
+ * @return flag specifying success or failure
+ */
+
+int ReadLineFromFile(FILE *fp, char *line){
+int i=0,inputSize=0;
+	if(feof(fp)){
+	return -1;
+	}
+	while(!feof(fp)){
+		int ch;
+		ch = fgetc(fp);
+		if(ch==EOF && inputSize == 0){
+			return -1;
+		}
+		else if(ch==EOF || ch == '\n'){
+			inputSize++;
+			line[i]='\0'; 
+			return 0;
+		}
+		else {
+			inputSize++;
+			if(inputSize > MAX_INPUT_LINE_LENGTH)
+			return inputSize; 
+			line[i++]=ch; 
+		}
+	}
+	line[i]='\0'; 
+	return 0;
+}
+
+/**
+ * NMEAReaderInit
+ * <p>
+ * This function prepares a block-buffered line reader on an open file descriptor.
+ * <p>
+ *
+ * @param  r Reader to initialise
+ * @param  fd File descriptor the input is read from
+ * @param  blockSize Number of bytes requested from read(2) at a time, 0 for the default
+ * @return 0 on success, -1 if the buffer could not be allocated
+ */
+int NMEAReaderInit(NMEALineReader *r, int fd, size_t blockSize) {
+	memset(r, 0, sizeof(*r));
+	if(blockSize == 0)
+		blockSize = NMEA_READER_BLOCK_SIZE;
+	if(blockSize <= MAX_INPUT_LINE_LENGTH)
+		blockSize = MAX_INPUT_LINE_LENGTH + 1;
+	r->fd = fd;
+	r->size = blockSize;
+	/* one spare byte so the last line of the input can always be NUL-terminated */
+	if((r->buf = malloc(blockSize + 1)) == NULL)
+		return -1;
+	return 0;
+}
+
+/**
+ * NMEAReaderNext
+ * <p>
+ * This function returns the next line of input as a view into the reader's buffer.
+ * The '\n' is replaced by a NUL, so the line can be sanitized in place; the view stays
+ * valid until the next call. Lines longer than MAX_INPUT_LINE_LENGTH are skipped and
+ * counted in r->oversized.
+ * <p>
+ *
+ * @param  r Reader returned by NMEAReaderInit
+ * @param  line Set to the start of the line
+ * @param  len Set to the length of the line, without the '\n'
+ * @return 1 if a line was returned, 0 at end of input, -1 on a read error
+ */
+int NMEAReaderNext(NMEALineReader *r, char **line, size_t *len) {
+	for(;;) {
+		char *start = r->buf + r->pos;
+		size_t avail = r->end - r->pos;
+		char *nl = memchr(start, '\n', avail);
+		ssize_t got;
+		if(nl != NULL) {
+			size_t n = nl - start;
+			r->pos += n + 1;
+			if(r->skipping) {
+				r->skipping = 0;
+				continue;
+			}
+			if(n > MAX_INPUT_LINE_LENGTH) {
+				r->oversized++;
+				continue;
+			}
+			*nl = '\0';
+			*line = start;
+			*len = n;
+			r->lines++;
+			return 1;
+		}
+		if(avail > MAX_INPUT_LINE_LENGTH) {
+			/* no line end within reach: drop what we have and skip to the next '\n' */
+			if(!r->skipping)
+				r->oversized++;
+			r->skipping = 1;
+			r->pos = r->end;
+			avail = 0;
+		}
+		if(r->eof) {
+			r->pos = r->end;
+			if(avail == 0 || r->skipping)
+				return 0;
+			start[avail] = '\0';
+			*line = start;
+			*len = avail;
+			r->lines++;
+			return 1;
+		}
+		/* move the partial line to the front and fill the rest of the block */
+		memmove(r->buf, start, avail);
+		r->offset += r->pos;
+		r->pos = 0;
+		r->end = avail;
+		got = read(r->fd, r->buf + r->end, r->size - r->end);
+		if(got < 0) {
+			if(errno == EINTR)
+				continue;
+			return -1;
+		}
+		if(got == 0)
+			r->eof = 1;
+		r->end += got;
+	}
+}
+
+/**
+ * NMEAReaderFree
+ * <p>
+ * This function releases the reader's buffer. The file descriptor is left open.
+ * <p>
+ *
+ * @param  r Reader returned by NMEAReaderInit
+ */
+void NMEAReaderFree(NMEALineReader *r) {
+	free(r->buf);
+	r->buf = NULL;
+}
+
+/**
+ * NMEAFramerInit
+ * <p>
+ * This function resets a framer to wait for the start of a sentence.
+ * <p>
+ *
+ * @param  f Framer to initialise
+ */
+void NMEAFramerInit(NMEAFramer *f) {
+	memset(f, 0, sizeof(*f));
+}
+
+/* Bytes dropped between sentences, not counting the LF of a CRLF, which a lone LF would replace */
+static size_t FramerDropped(const char *p, const char *end) {
+	size_t n = end - p;
+	while((p = memchr(p, '\r', end - p)) != NULL && ++p < end)
+		n -= *p == '\n';
+	return n;
+}
+
+/**
+ * NMEAFramerPush
+ * <p>
+ * This function feeds a chunk of bytes of any size to the framer. Every sentence completed
+ * by the chunk is passed to handler, from '$' up to but excluding the line end. A sentence
+ * that lies entirely inside the chunk is handed over in place; only one that straddles a
+ * chunk boundary is assembled in the framer's own buffer. A CR, LF or CRLF ends a line,
+ * even when the CR and LF arrive in different chunks. Other bytes outside a sentence are
+ * dropped and counted, a '$' inside a sentence abandons it and starts a new one, and a sentence longer
+ * than MAX_INPUT_LINE_LENGTH is skipped up to its line end. Each byte is examined once.
+ * <p>
+ *
+ * @param  f Framer holding the state carried between chunks
+ * @param  data Bytes received
+ * @param  len Number of bytes received
+ * @param  handler Called for every complete sentence
+ * @param  ctx Passed through to handler
+ */
+void NMEAFramerPush(NMEAFramer *f, const char *data, size_t len, NMEASentenceHandler handler, void *ctx) {
+	const char *p = data, *end = data + len;
+	while(p < end) {
+		const char *start, *q;
+		if(f->state == NMEA_FRAMER_CR) {
+			/* the LF of a CRLF line end belongs to the line, not to the bytes dropped */
+			if(*p == '\n')
+				p++;
+			f->state = NMEA_FRAMER_IDLE;
+			continue;
+		}
+		if(f->state == NMEA_FRAMER_IDLE) {
+			start = memchr(p, '$', end - p);
+			if(start == NULL) {
+				f->discarded += FramerDropped(p, end);
+				if(end[-1] == '\r')
+					f->state = NMEA_FRAMER_CR;
+				return;
+			}
+			f->discarded += FramerDropped(p, start);
+			f->state = NMEA_FRAMER_SENTENCE;
+			f->len = 0;
+			p = start;
+		}
+		/* find the end of the current sentence, or a '$' that restarts it */
+		start = p;
+		q = (f->state == NMEA_FRAMER_SENTENCE && f->len == 0) ? p + 1 : p;
+		while(q < end && *q != '\n' && *q != '\r' && *q != '$')
+			q++;
+		if(f->state == NMEA_FRAMER_OVERSIZED) {
+			if(q == end)
+				return;
+			f->state = *q == '$' ? NMEA_FRAMER_SENTENCE : *q == '\r' ? NMEA_FRAMER_CR : NMEA_FRAMER_IDLE;
+			f->len = 0;
+			p = *q == '$' ? q : q + 1;
+			continue;
+		}
+		if(f->len + (q - start) > MAX_INPUT_LINE_LENGTH) {
+			f->overflows++;
+			f->state = NMEA_FRAMER_OVERSIZED;
+			p = q;
+			continue;
+		}
+		if(q == end) {
+			memcpy(f->buf + f->len, start, q - start);
+			f->len += q - start;
+			return;
+		}
+		if(*q == '$') {
+			f->resyncs++;
+			f->len = 0;
+			p = q;
+			continue;
+		}
+		f->sentences++;
+		f->state = *q == '\r' ? NMEA_FRAMER_CR : NMEA_FRAMER_IDLE;
+		if(f->len == 0) {
+			handler(ctx, start, q - start);
+		}
+		else {
+			memcpy(f->buf + f->len, start, q - start);
+			handler(ctx, f->buf, f->len + (q - start));
+			f->len = 0;
+		}
+		p = q + 1;
+	}
+}
+
+/**
+ * NMEAFramerFinish
+ * <p>
+ * This function passes a pending sentence that was not followed by a line end to
+ * handler, for use when the stream ends.
+ * <p>
+ *
+ * @param  f Framer holding the pending sentence
+ * @param  handler Called if a sentence was pending
+ * @param  ctx Passed through to handler
+ */
+void NMEAFramerFinish(NMEAFramer *f, NMEASentenceHandler handler, void *ctx) {
+	if(f->state == NMEA_FRAMER_SENTENCE && f->len > 0) {
+		f->sentences++;
+		handler(ctx, f->buf, f->len);
+	}
+	f->state = NMEA_FRAMER_IDLE;
+	f->len = 0;
+}
+
+/*
+ * Single-producer/single-consumer sentence ring. The producer fills slots past its
+ * private 'write' index and makes them visible with one release store of 'tail' per
+ * batch; the consumer reads them past 'read' and hands them back with one release
+ * store of 'head'. Neither side takes a lock: a side that finds the ring full or empty
+ * spins briefly, then yields and finally sleeps for growing intervals up to 1 ms.
+ */
+
+static void RingWait(unsigned int *spins) {
+	struct timespec ts;
+	if(++*spins < 64) {
+#ifdef NMEA_HAVE_X86_SIMD
+		_mm_pause();
+#endif
 		return;
 	}
-	if((p2=strchr(buf,','))==NULL) {	
-		printf("Wrong format\n");
+	if(*spins < 128) {
+		sched_yield();
 		return;
 	}
-	else {
-		if(p2-buf==0) {
-			printf("Height of geoid not specified\n");
-			buf++;
-			index++;
+	ts.tv_sec = 0;
+	ts.tv_nsec = *spins < 132 ? 50000L << (*spins - 128) : 1000000L;
+	nanosleep(&ts, NULL);
+}
+
+/**
+ * NMEARingInit
+ * <p>
+ * This function allocates the slots of a ring and leaves it empty.
+ * <p>
+ *
+ * @param  r Ring to initialize
+ * @param  slots Number of slots, rounded up to a power of two of at least two batches;
+ *         0 for NMEA_RING_SLOTS
+ * @return 0 on success, -1 if the slots could not be allocated
+ */
+int NMEARingInit(NMEARing *r, size_t slots) {
+	size_t size = 2 * NMEA_RING_BATCH;
+	memset(r, 0, sizeof(*r));
+	if(slots == 0)
+		slots = NMEA_RING_SLOTS;
+	while(size < slots)
+		size *= 2;
+	if(posix_memalign((void **)&r->slots, NMEA_CACHE_LINE, size * sizeof(NMEARingSlot)) != 0)
+		return -1;
+	r->size = size;
+	return 0;
+}
+
+/**
+ * NMEARingPublish
+ * <p>
+ * This function makes every committed slot visible to the consumer. The producer calls
+ * it before it may block, so that a partial batch is not held back.
+ * <p>
+ *
+ * @param  r Ring, from the producer thread
+ */
+void NMEARingPublish(NMEARing *r) {
+	if(r->write == r->tail)
+		return;
+	__atomic_store_n(&r->tail, r->write, __ATOMIC_RELEASE);
+	r->batches++;
+}
+
+/**
+ * NMEARingReserve
+ * <p>
+ * This function returns the next free slot for the producer to fill, waiting while the
+ * ring is full. Each wait for the consumer counts as one full stall.
+ * <p>
+ *
+ * @param  r Ring, from the producer thread
+ * @return Slot to fill, then hand over with NMEARingCommit
+ */
+NMEARingSlot *NMEARingReserve(NMEARing *r) {
+	unsigned int spins = 0;
+	if(r->write - r->cachedHead >= r->size) {
+		r->cachedHead = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+		if(r->write - r->cachedHead >= r->size) {
+			NMEARingPublish(r);
+			r->fullStalls++;
+			do {
+				RingWait(&spins);
+				r->cachedHead = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+			} while(r->write - r->cachedHead >= r->size);
 		}
-		else {
-			index+=(p2-buf+1);
-			strncpy(auxBuf, buf, p2 - buf);
-			auxBuf[p2 - buf] = '\0';
-			buf = p2 + 1;
-			if (checkdigit(auxBuf,1)<0) {
-				printf("Height of geoid must be a number");
-				return;
+	}
+	return &r->slots[r->write & (r->size - 1)];
+}
+
+/**
+ * NMEARingCommit
+ * <p>
+ * This function hands the slot returned by NMEARingReserve over, publishing a batch
+ * every NMEA_RING_BATCH slots.
+ * <p>
+ *
+ * @param  r Ring, from the producer thread
+ */
+void NMEARingCommit(NMEARing *r) {
+	if(++r->write - r->tail >= NMEA_RING_BATCH)
+		NMEARingPublish(r);
+}
+
+/**
+ * NMEARingClose
+ * <p>
+ * This function publishes the last slots and tells the consumer that no more follow.
+ * <p>
+ *
+ * @param  r Ring, from the producer thread
+ */
+void NMEARingClose(NMEARing *r) {
+	NMEARingPublish(r);
+	__atomic_store_n(&r->closed, 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * NMEARingAvailable
+ * <p>
+ * This function returns the number of slots the consumer can take without waiting. It
+ * reads the producer's index only when the slots already seen have all been taken.
+ * <p>
+ *
+ * @param  r Ring, from the consumer thread
+ * @return Number of published slots not yet taken
+ */
+size_t NMEARingAvailable(NMEARing *r) {
+	if(r->read == r->cachedTail)
+		r->cachedTail = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+	return r->cachedTail - r->read;
+}
+
+/**
+ * NMEARingNext
+ * <p>
+ * This function takes the next slot, waiting while the ring is empty. The slot stays
+ * valid until the following call, which hands it back to the producer. Occupancy is
+ * sampled every time the consumer looks at the producer's index.
+ * <p>
+ *
+ * @param  r Ring, from the consumer thread
+ * @return Next slot, NULL once the ring is closed and drained
+ */
+const NMEARingSlot *NMEARingNext(NMEARing *r) {
+	unsigned int spins = 0;
+	size_t used;
+	if(r->read == r->cachedTail) {
+		/* everything seen has been consumed: hand it back before looking for more */
+		__atomic_store_n(&r->head, r->read, __ATOMIC_RELEASE);
+		r->cachedTail = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+		while(r->read == r->cachedTail) {
+			if(__atomic_load_n(&r->closed, __ATOMIC_ACQUIRE)) {
+				/* the last slots were published before closed was set */
+				r->cachedTail = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+				if(r->read == r->cachedTail)
+					return NULL;
+				break;
+			}
+			if(spins == 0)
+				r->emptyStalls++;
+			RingWait(&spins);
+			r->cachedTail = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+		}
+		used = r->cachedTail - r->read;
+		r->samples++;
+		r->occupancy += used;
+		if(used > r->peak)
+			r->peak = used;
+	}
+	else if(r->read % NMEA_RING_BATCH == 0)
+		__atomic_store_n(&r->head, r->read, __ATOMIC_RELEASE);
+	return &r->slots[r->read++ & (r->size - 1)];
+}
+
+/**
+ * NMEARingFree
+ * <p>
+ * This function releases the slots of a ring once both threads are done with it.
+ * <p>
+ *
+ * @param  r Ring returned by NMEARingInit
+ */
+void NMEARingFree(NMEARing *r) {
+	free(r->slots);
+	r->slots = NULL;
+}
+
+/**
+ * SanitizeInput                         
+ * <p>
+ * This function removes white spaces from input string.
+ * <p> 
+ * 
+ * @param  input Buffer containing the input string passed as input as well as processed output. 
+ */
+void SanitizeInput(char *input) {
+	int i=0,j=0;
+	while(input[j] != '\0') {
+		if(isspace(input[j])){
+		//if(input[j]) {
+			j++;
+		}
+ 		else {
+			input[i] = input[j];
+			i++;
+			j++;
+ 		}
+	}
+	input[i]='\0';
+}
+
+/**
+ * SanitizeView
+ * <p>
+ * This function is the non-mutating equivalent of SanitizeInput for read-only input such
+ * as a mapped file. Leading and trailing white space is trimmed by narrowing the view;
+ * only a line with white space inside it is compacted, into the caller's scratch buffer.
+ * <p>
+ *
+ * @param  input Start of the line
+ * @param  len Length of the line
+ * @param  scratch Buffer of at least len+1 bytes used when the line must be compacted
+ * @param  outLen Set to the length of the sanitized line
+ * @return Start of the sanitized line, either inside input or scratch
+ */
+const char *SanitizeView(const char *input, size_t len, char *scratch, size_t *outLen) {
+	size_t i, j;
+	while(len > 0 && isspace((unsigned char)input[len-1]))
+		len--;
+	while(len > 0 && isspace((unsigned char)input[0])) {
+		input++;
+		len--;
+	}
+	for(i=0;i<len;i++) {
+		if(isspace((unsigned char)input[i]))
+			break;
+	}
+	if(i == len) {
+		*outLen = len;
+		return input;
+	}
+	memcpy(scratch, input, i);
+	for(j=i;i<len;i++) {
+		if(!isspace((unsigned char)input[i]))
+			scratch[j++] = input[i];
+	}
+	scratch[j] = '\0';
+	*outLen = j;
+	return scratch;
+}
+
+/**
+ * NMEAMapFile
+ * <p>
+ * This function maps a whole file read-only so it can be parsed in place.
+ * <p>
+ *
+ * @param  path File to map
+ * @param  m Receives the mapping; data is NULL for an empty file
+ * @param  advice madvise(2) access pattern hint, e.g. MADV_SEQUENTIAL
+ * @return 0 on success, -1 with errno set on failure
+ */
+int NMEAMapFile(const char *path, NMEAMappedFile *m, int advice) {
+	struct stat st;
+	int fd;
+	m->data = NULL;
+	m->size = 0;
+	if((fd = open(path, O_RDONLY)) < 0)
+		return -1;
+	if(fstat(fd, &st) < 0) {
+		close(fd);
+		return -1;
+	}
+	if(st.st_size > 0) {
+		void *p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if(p == MAP_FAILED) {
+			close(fd);
+			return -1;
+		}
+		madvise(p, st.st_size, advice);
+		m->data = p;
+		m->size = st.st_size;
+	}
+	close(fd);
+	return 0;
+}
+
+/**
+ * NMEAUnmapFile
+ * <p>
+ * This function releases a mapping made by NMEAMapFile.
+ * <p>
+ *
+ * @param  m Mapping to release
+ */
+void NMEAUnmapFile(NMEAMappedFile *m) {
+	if(m->data != NULL)
+		munmap((void *)m->data, m->size);
+	m->data = NULL;
+	m->size = 0;
+}
+
+/* Per-sentence state of the input format checker, see ValidateStep */
+typedef struct {
+	int digitFound;
+	int starFound;
+	int DirectionFound;
+	int dotFound;
+	int HexDigit;
+	int ManualFound;
+	int AutoFound;
+	int VFound;
+} ValidateState;
+
+/**
+ * ValidateStep
+ * <p>
+ * This function advances the input format checker by one character. It is the state
+ * machine of CheckInputExceptions; the transition table of the fused scan in
+ * NMEAScanLine is generated from it, so both accept and reject exactly the same input.
+ * <p>
+ *
+ * @param  v State of the checker, zeroed before the first character
+ * @param  c Next character of the input
+ * @return 0 if the character is acceptable here, -1 if it is an error
+ */
+static inline int ValidateStep(ValidateState *v, char c) {
+	switch(c){
+		case '0':
+		case '1':
+		case '2':
+		case '3':
+		case '4':
+		case '5':
+		case '6':
+		case '7':
+		case '8':
+		case '9':
+			if((v->DirectionFound > 0) || ((v->starFound >0) && ((v->HexDigit+v->digitFound)>=2))){
+				return -1;
 			}
-			if((p2 = strchr(buf, ',')) == NULL) {
-				printf("Wrong format");
-				exit(0);
+			v->digitFound++;
+			break;		 
+		case '.':
+			if(v->dotFound > 0){
+				return -1;
 			}
-			if(p2 - buf != 1) {
-				printf("\nNot valid GPGGA sentence format, Unit of geoid height measurement missing\n");
-				return;
+			v->dotFound++;
+			break;		 
+		case ',':
+			v->digitFound=0;
+			v->starFound=0;
+			v->DirectionFound=0;
+			v->dotFound=0;
+			v->HexDigit=0;
+			break;
+
+		case '*':
+			if(v->starFound > 0){
+				return -1;
 			}
-			if(*buf == 'M')
-				printf("Height of geoid (m) above WGS84 ellipsoid: %s\n", auxBuf);
-			else {
-				printf("Wrong unit for geoid height measurement specified.");
-				return;
+			v->starFound++;
+			v->digitFound=0;
+			break;		 
+		case 'A':
+			if((v->digitFound==0) && (v->HexDigit==0) && (v->DirectionFound==0) && (v->dotFound==0) && (v->starFound==0) && (v->AutoFound==0)) {
+				v->AutoFound++;
+				break;
+			}
+			if(v->starFound == 0){
+				return -1;
+			}
+			if(v->HexDigit >=2){
+				return -1;
+			}
+			v->HexDigit++;
+			break;		 
+		case 'B':
+		case 'C':
+		case 'D':
+			if(v->starFound == 0){
+				return -1;
+			}
+			if(v->HexDigit >=2){
+				return -1;
+			}
+			v->HexDigit++;
+			break;		 
+		case 'E':
+			if(v->starFound == 0){
+				if(v->DirectionFound>0){
+						return -1;
+				}
+				else {
+					if((v->digitFound==0) && (v->HexDigit==0) && (v->DirectionFound==0)){
+						v->DirectionFound++;
+						break;
+					}
+					else {
+								return -1;
+					}		
+				}
+			}
+			if(v->HexDigit >=2){
+				return -1;
+			}
+			v->HexDigit++;
+			break;		 
+		case 'F':
+			if(v->starFound == 0){
+				return -1;
+			}
+			if(v->HexDigit >=2){
+				return -1;
+			}
+			v->HexDigit++;
+			break;		 
+	
+		case 'a':
+			if((v->digitFound==0) && (v->HexDigit==0) && (v->DirectionFound==0) && (v->dotFound==0) && (v->starFound==0) && (v->AutoFound==0)) {
+				v->AutoFound++;
+				break;
+			}
+			if(v->starFound == 0){
+				return -1;
+			}
+			if(v->HexDigit >=2){
+				return -1;
+			}
+			v->HexDigit++;
+			break;		 
+		case 'b':
+		case 'c':
+		case 'd':
+			if(v->starFound == 0){
+				return -1;
+			}
+			if(v->HexDigit >=2){
+				return -1;
+			}
+			v->HexDigit++;
+			break;		 
+		case 'e':
+			if(v->starFound == 0){
+				if(v->DirectionFound>0){
+						return -1;
+				}
+				else{
+					if((v->digitFound==0)  && (v->HexDigit==0) && (v->DirectionFound==0)){
+						v->DirectionFound++;
+						break;
+					}
+					else{
+								return -1;
+					}		
+				}
+			}
+			if(v->HexDigit >=2){
+				return -1;
+			}
+			v->HexDigit++;
+			break;		 
+		case 'f':
+			if(v->starFound == 0){
+				return -1;
+			}
+			if(v->HexDigit >=2){
+				return -1;
+			}
+			v->HexDigit++;
+			break;		 
+
+		case 'm':
+			if((v->digitFound==0) && (v->HexDigit==0) && (v->DirectionFound==0) && (v->dotFound==0) && (v->starFound==0)){
+				v->ManualFound++;
+			}
+			else{
+				return -1;
+			}		
+			/* fall through */
+		case 'v':
+			if((v->digitFound==0) && (v->HexDigit==0) && (v->DirectionFound==0) && (v->dotFound==0) && (v->starFound==0) && (v->AutoFound==0)&&(v->VFound==0)){
+				v->VFound++;
+				break;
+			}
+			else{
+				return -1;
+			}		
+		case 'M':
+			if((v->digitFound==0) && (v->HexDigit==0) && (v->DirectionFound==0) && (v->dotFound==0) && (v->starFound==0)){
+				v->ManualFound++;
+			}
+			else{
+				return -1;
+			}		
+	
+			/* fall through */
+	
+		case 'N':
+		case 'S':
+			if((v->digitFound==0) && (v->starFound==0) && (v->HexDigit==0) && (v->DirectionFound==0)){
+				v->DirectionFound++;
+				break;
+			}
+			else{
+				return -1;
+			}		
+		case 'V':
+			if((v->digitFound==0) && (v->HexDigit==0) && (v->DirectionFound==0) && (v->dotFound==0) && (v->starFound==0) && (v->AutoFound==0)&&(v->VFound==0)){
+				v->VFound++;
+				break;
+			}
+			else{
+				return -1;
+			}		
+
+		case 'W':	
+			if((v->digitFound==0) && (v->starFound==0) && (v->HexDigit==0) && (v->DirectionFound==0)){
+				v->DirectionFound++;
+				break;
+			}
+			else{
+				return -1;
+			}		
+	
+		default:
+			return -1;
+	}
+	return 0;
+}
+
+/**
+ * CheckInputExceptions                         
+ * <p>
+ * This function checks the input string for various irregullarities in format.
+ * <p> 
+ * 
+ * @param  input Buffer containing the input string. 
+ * @param  len Length of the input string.
+ * @return value, 0 if no error found, else location of first error.
+ */
+int CheckInputExceptions(const char *input, size_t len){
+	ValidateState v;
+	size_t i;
+	if(len == 0 || input[0] != ',')
+		return 1;
+	memset(&v, 0, sizeof(v));
+	for(i=0;i<len;i++) {
+		if(ValidateStep(&v, input[i]) < 0)
+			return i;
+	}
+	return 0;
+}
+
+/*
+ * Table-driven form of ValidateStep for the fused scan. The checker only ever compares
+ * digitFound and HexDigit against 0 and 2 and never reads ManualFound, and its other
+ * counters cannot pass 1 without an error, so 288 saturated states cover it exactly.
+ * The table is generated from ValidateStep itself. Characters are reduced to classes;
+ * white space is not part of the checker's input and is dropped before it.
+ */
+enum {
+	LC_OTHER = 0,
+	LC_DIGIT,
+	LC_DOT,
+	LC_COMMA,
+	LC_STAR,
+	LC_A,
+	LC_HEX,
+	LC_E,
+	LC_F,
+	LC_LOWER_M,
+	LC_V,
+	LC_UPPER_M,
+	LC_DIRECTION,
+	LC_CLASS_COUNT,
+	LC_SPACE = LC_CLASS_COUNT
+};
+
+#define VALIDATE_STATES 288
+#define VALIDATE_FIRST VALIDATE_STATES
+#define VALIDATE_ERROR (VALIDATE_STATES+1)
+
+static const unsigned char lineClass[256] = {
+	['0'] = LC_DIGIT, ['1'] = LC_DIGIT, ['2'] = LC_DIGIT, ['3'] = LC_DIGIT, ['4'] = LC_DIGIT,
+	['5'] = LC_DIGIT, ['6'] = LC_DIGIT, ['7'] = LC_DIGIT, ['8'] = LC_DIGIT, ['9'] = LC_DIGIT,
+	['.'] = LC_DOT, [','] = LC_COMMA, ['*'] = LC_STAR,
+	['A'] = LC_A, ['a'] = LC_A,
+	['B'] = LC_HEX, ['C'] = LC_HEX, ['D'] = LC_HEX, ['b'] = LC_HEX, ['c'] = LC_HEX, ['d'] = LC_HEX,
+	['E'] = LC_E, ['e'] = LC_E, ['F'] = LC_F, ['f'] = LC_F,
+	['m'] = LC_LOWER_M, ['V'] = LC_V, ['v'] = LC_V, ['M'] = LC_UPPER_M,
+	['N'] = LC_DIRECTION, ['S'] = LC_DIRECTION, ['W'] = LC_DIRECTION,
+	[' '] = LC_SPACE, ['\t'] = LC_SPACE, ['\n'] = LC_SPACE, ['\v'] = LC_SPACE, ['\f'] = LC_SPACE, ['\r'] = LC_SPACE
+};
+
+static unsigned short validateTable[VALIDATE_STATES+2][LC_CLASS_COUNT];
+static pthread_once_t validateTableOnce = PTHREAD_ONCE_INIT;
+
+static unsigned int ValidateEncode(const ValidateState *v) {
+	unsigned int digits = v->digitFound < 2 ? v->digitFound : 2;
+	unsigned int hex = v->HexDigit < 2 ? v->HexDigit : 2;
+	return digits + 3*(hex + 3*(v->starFound + 2*(v->DirectionFound + 2*(v->dotFound + 2*(v->AutoFound + 2*v->VFound)))));
+}
+
+static void ValidateDecode(unsigned int s, ValidateState *v) {
+	memset(v, 0, sizeof(*v));
+	v->digitFound = s % 3; s /= 3;
+	v->HexDigit = s % 3; s /= 3;
+	v->starFound = s % 2; s /= 2;
+	v->DirectionFound = s % 2; s /= 2;
+	v->dotFound = s % 2; s /= 2;
+	v->AutoFound = s % 2; s /= 2;
+	v->VFound = s;
+}
+
+static void BuildValidateTable(void) {
+	static const char sample[LC_CLASS_COUNT] = { '$', '0', '.', ',', '*', 'A', 'B', 'E', 'F', 'm', 'V', 'M', 'N' };
+	unsigned int s, k;
+	for(s=0;s<VALIDATE_STATES;s++) {
+		for(k=0;k<LC_CLASS_COUNT;k++) {
+			ValidateState v;
+			ValidateDecode(s, &v);
+			validateTable[s][k] = ValidateStep(&v, sample[k]) < 0 ? VALIDATE_ERROR : ValidateEncode(&v);
+		}
+	}
+	for(k=0;k<LC_CLASS_COUNT;k++) {
+		validateTable[VALIDATE_FIRST][k] = k == LC_COMMA ? 0 : VALIDATE_ERROR;
+		validateTable[VALIDATE_ERROR][k] = VALIDATE_ERROR;
+	}
+}
+
+/**
+ * NMEAScanLine
+ * <p>
+ * This function does in one pass over a raw input line what SanitizeView,
+ * CheckInputExceptions and NMEATokenize do in three: it drops white space, runs the
+ * input format checker from the seventh sanitized character on, records the field
+ * offsets and identifies the sentence type. A line that does not start with '$' is
+ * abandoned at its first character.
+ * <p>
+ *
+ * @param  line Start of the input line
+ * @param  len Length of the input line
+ * @param  scratch Buffer of at least len+1 bytes used when the line must be compacted
+ * @param  s Receives the sanitized line, its field table, its type and the location of
+ *           the first format error as CheckInputExceptions would report it, or 0
+ */
+void NMEAScanLine(const char *line, size_t len, char *scratch, NMEAScannedLine *s) {
+	NMEAFields *f = &s->fields;
+	unsigned int state = VALIDATE_FIRST;
+	unsigned int begin = 1;
+	int tokenize = 1;
+	char *dst = NULL;
+	size_t i, j = 0;
+	pthread_once(&validateTableOnce, BuildValidateTable);
+	while(len > 0 && lineClass[(unsigned char)line[len-1]] == LC_SPACE)
+		len--;
+	while(len > 0 && lineClass[(unsigned char)line[0]] == LC_SPACE) {
+		line++;
+		len--;
+	}
+	f->count = 0;
+	f->star = -1;
+	s->buf = line;
+	s->len = len;
+	s->errorLoc = 0;
+	s->type = NMEA_TYPE_UNKNOWN;
+	if(len == 0 || line[0] != '$')
+		return;
+	for(i=0;i<len;i++) {
+		char c = line[i];
+		unsigned int cls = lineClass[(unsigned char)c];
+		if(cls == LC_SPACE) {
+			if(dst == NULL) {
+				memcpy(scratch, line, i);
+				dst = scratch;
+			}
+			continue;
+		}
+		if(dst != NULL)
+			dst[j] = c;
+		if(j >= 6) {
+			state = validateTable[state][cls];
+			if(state == VALIDATE_ERROR && s->errorLoc == 0)
+				s->errorLoc = j > 6 ? j - 6 : 1;
+		}
+		if((cls == LC_COMMA || cls == LC_STAR) && tokenize) {
+			if(f->count < NMEA_MAX_FIELDS) {
+				f->start[f->count] = begin;
+				f->len[f->count++] = j - begin;
 			}
-			index+=(p2-buf+1);
-			buf = p2 + 1;
+			begin = j + 1;
+			if(cls == LC_STAR) {
+				f->star = j;
+				tokenize = 0;
+			}
+		}
+		j++;
+	}
+	if(dst != NULL) {
+		dst[j] = '\0';
+		s->buf = dst;
+	}
+	s->len = j;
+	if(j <= 6)
+		s->errorLoc = 1;
+	if(tokenize && f->count < NMEA_MAX_FIELDS) {
+		f->start[f->count] = begin;
+		f->len[f->count++] = j - begin;
+	}
+	if(s->errorLoc == 0)
+		s->type = NMEAParseType(s->buf, f);
+}
+
+/* Arrow files of an export run, one per sentence type, each created by the first sentence of its type */
+typedef struct {
+	const char *prefix;
+	size_t batchRows;
+	NMEAArrowWriter writer[NMEA_TYPE_COUNT];
+	int open[NMEA_TYPE_COUNT];
+	int error;
+} ArrowExport;
+
+/**
+ * ArrowExportSentence
+ * <p>
+ * This function appends a decoded sentence to the Arrow file of its type, creating
+ * <prefix>-<type>.arrow first if needed. After a failure the export stops writing.
+ * <p>
+ *
+ * @param  e Export state
+ * @param  s Sentence decoded without error
+ */
+static void ArrowExportSentence(ArrowExport *e, const NMEASentence *s) {
+	char path[4096];
+	if(e->error || s->type == NMEA_TYPE_UNKNOWN || s->type >= NMEA_TYPE_COUNT)
+		return;
+	if(!e->open[s->type]) {
+		snprintf(path, sizeof(path), "%s-%s.arrow", e->prefix, columnSchemas[s->type].name);
+		if(NMEAArrowOpen(&e->writer[s->type], path, s->type, e->batchRows) < 0) {
+			fprintf(stderr, "Unable to write %s: %s\n", path, strerror(errno));
+			e->error = 1;
+			return;
 		}
+		e->open[s->type] = 1;
 	}
-	
-	// Time since last DGPS update
-	if(index>=bufSize)
-	{
-		printf("End of string");
+	if(NMEAArrowAppend(&e->writer[s->type], s) < 0)
+		e->error = 1;
+}
+
+/* Closes every Arrow file of the export; returns -1 if any of them could not be written */
+static int ArrowExportClose(ArrowExport *e) {
+	int type;
+	for(type=NMEA_TYPE_UNKNOWN+1;type<NMEA_TYPE_COUNT;type++)
+		if(e->open[type] && NMEAArrowClose(&e->writer[type]) < 0)
+			e->error = 1;
+	return e->error ? -1 : 0;
+}
+
+/*
+ * Output sink and counters of one parsing run, or of one chunk of a parallel run; no output when out is NULL.
+ * offset is the position of the current line in the input, kept for the index writer by RunBuffered and
+ * ProcessLines. With window set, only the sentences timed within [from, to] of the log clock are output,
+ * from the first timed sentence at or after from; stop is raised at the first one after to. source is the
+ * ID of the stream being read, tagged onto its sentences when several are multiplexed.
+ */
+typedef struct {
+	NMEASink *out;
+	ArrowExport *arrow;
+	NMEAIndexWriter *index;
+	NMEAGSVAssembler *sky;
+	NMEAEpochAssembler *epochs;
+	uint64_t offset;
+	int window;
+	uint64_t from;
+	uint64_t to;
+	NMEALogClock clock;
+	int outside;
+	int stop;
+	unsigned int source;
+	unsigned long sentences;
+	unsigned long rejected;
+	unsigned long garbage;
+	unsigned long oversized;
+} RunContext;
+
+/* Feeds the time of a decoded sentence to the index being built and to the time window */
+static void TrackTime(RunContext *ctx, uint32_t ms) {
+	uint64_t t;
+	if(ctx->index != NULL)
+		NMEAIndexAdd(ctx->index, ms, ctx->offset);
+	if(ctx->window) {
+		t = NMEALogClockAdvance(&ctx->clock, ms);
+		ctx->outside = t < ctx->from;
+		if(t > ctx->to)
+			ctx->outside = ctx->stop = 1;
+	}
+}
+
+/* Prints a fix emitted by the epoch assembler */
+static void FixReady(void *ctx, const NMEAFix *fix) {
+	RunContext *run = ctx;
+	if(run->out != NULL)
+		NMEASinkFix(run->out, fix);
+}
+
+/**
+ * ReportLine
+ * <p>
+ * This function counts one scanned sentence and hands it, decoded unless the scan
+ * rejected it and tagged with the current source, to the index, the time window, the Arrow export, the assemblers and the
+ * output sink.
+ * <p>
+ *
+ * @param  scan Scanned sentence, starting with '$'
+ * @param  status Status of the decoder, unused when the scan rejected the sentence
+ * @param  sentence Decoded sentence
+ * @param  ctx Output stream and counters for the sentence
+ */
+static void ReportLine(const NMEAScannedLine *scan, NMEAStatus status, NMEASentence *sentence, RunContext *ctx) {
+	uint32_t ms;
+	ctx->sentences++;
+	if(scan->errorLoc > 0){
+		ctx->rejected++;
+		if(ctx->out != NULL && !ctx->outside)
+			NMEASinkInvalid(ctx->out, scan->buf, scan->len, scan->errorLoc, ctx->source);
 		return;
 	}
-	if((p2=strchr(buf,','))==NULL) {	
-		printf("Wrong format\n");
+	sentence->source = ctx->source;
+	if(status != NMEA_OK)
+		ctx->rejected++;
+	else if((ctx->index != NULL || ctx->window) && NMEASentenceTime(sentence, &ms))
+		TrackTime(ctx, ms);
+	if(ctx->outside)
+		return;
+	if(status == NMEA_OK && ctx->arrow != NULL)
+		ArrowExportSentence(ctx->arrow, sentence);
+	if(status == NMEA_OK && ctx->epochs != NULL && sentence->type != NMEA_TYPE_GSV) {
+		// GGA, GSA, GST and GLL are reported together once their epoch is assembled
+		NMEAEpochPush(ctx->epochs, sentence, FixReady, ctx);
 		return;
 	}
-	else {
-		if(p2-buf==0) {
-			printf("Time since last DGPS update not specified\n");
-			buf++;
-			index++;
-		}
-		else {
-			index+=(p2-buf+1);
-			strncpy(auxBuf, buf, p2 - buf);
-			auxBuf[p2 - buf] = '\0';
-			buf = p2 + 1;
-			if (checkdigit(auxBuf,0)<0) {
-				printf("Time must be a number");
-				return;
-			}
-			printf("Time since last DGPS update: %s\n", auxBuf);
-		}
+	if(status == NMEA_OK && ctx->sky != NULL && sentence->type == NMEA_TYPE_GSV) {
+		// Parts of a GSV cycle are reported together once the cycle is complete
+		const NMEASkyView *view = NMEAGSVAssemblerPush(ctx->sky, sentence->talker, &sentence->u.gsv);
+		if(view != NULL && ctx->out != NULL)
+			NMEASinkSkyView(ctx->out, view);
 	}
-	
-	// Differential reference station ID
-	if(index>=bufSize)
-	{
-		printf("End of string");
+	else if(ctx->out != NULL)
+		NMEASinkSentence(ctx->out, sentence, status);
+}
+
+/**
+ * ProcessLine
+ * <p>
+ * This function sanitizes, validates and tokenizes one input line in a single scan,
+ * then decodes and prints it.
+ * The line is not modified. Lines that do not start with '$' are skipped and counted.
+ * <p>
+ *
+ * @param  line Start of the input line
+ * @param  len Length of the input line
+ * @param  ctx Output stream and counters for the line
+ */
+static void ProcessLine(const char *line, size_t len, RunContext *ctx) {
+	char scratch[MAX_INPUT_LINE_LENGTH+1];
+	NMEAScannedLine scan;
+	NMEASentence sentence;
+	NMEAStatus status = NMEA_OK;
+	if(len > MAX_INPUT_LINE_LENGTH) {
+		ctx->oversized++;
 		return;
 	}
-	if((p2=strchr(buf,','))==NULL) {	
-		printf("Wrong format\n");
+	NMEAScanLine(line, len, scratch, &scan);
+	if(scan.len == 0)
+		return;
+	if(scan.buf[0] != '$') {
+		ctx->garbage++;
 		return;
 	}
-	else {
-		if(p2-buf==0) {
-			printf("Differential reference station ID  not specified\n");
-			buf++;
-			index++;
-		}
-		else {
-			index+=(p2-buf+1);
-			strncpy(auxBuf, buf, p2 - buf);
-			auxBuf[p2 - buf] = '\0';
-			buf = p2 + 1;
-			if (checkdigit(auxBuf,0)<0) {
-				printf("Differential reference station ID must be a number");
+	if(scan.errorLoc == 0)
+		status = NMEADecodeSentence(scan.buf, scan.len, &scan.fields, scan.type, &sentence);
+	ReportLine(&scan, status, &sentence, ctx);
+}
+
+/**
+ * ProcessLines
+ * <p>
+ * This function parses every line of a buffer in place, finding the line ends from
+ * the structural scan, up to the end of the time window if there is one.
+ * <p>
+ *
+ * @param  data Start of the buffer
+ * @param  size Size of the buffer
+ * @param  ctx Output stream and counters for every line
+ */
+static void ProcessLines(const char *data, size_t size, RunContext *ctx) {
+	size_t base, start = 0;
+	for(base=0;base<size;base+=64) {
+		NMEAStructMasks m;
+		NMEAStructuralScan(data + base, size - base, &m);
+		while(m.lf != 0) {
+			size_t nl = base + __builtin_ctzll(m.lf);
+			m.lf &= m.lf - 1;
+			ctx->offset = start;
+			ProcessLine(data + start, nl - start, ctx);
+			if(ctx->stop)
 				return;
-			}
-			printf("Differential reference station ID : %s\n", auxBuf);
+			start = nl + 1;
 		}
 	}
-	
-	// Checksum
-	if(buf[0]!='*')
-		printf("Not valid GPGGA sentence format. Terminal '*' missing");
-	else
-		printf("\n**********GPGGA format string parsing complete**********\n");
+	ctx->offset = start;
+	if(start < size)
+		ProcessLine(data + start, size - start, ctx);
+}
 
+/**
+ * RunFile
+ * <p>
+ * This function parses a file through stdio, one ReadLineFromFile call per line.
+ * <p>
+ *
+ * @param  path File to parse
+ * @param  ctx Output stream and counters for every line
+ * @return 0 on success, -1 if the file could not be opened
+ */
+static int RunFile(const char *path, RunContext *ctx) {
+	char line[MAX_INPUT_LINE_LENGTH+1];
+	FILE *fp;
+	int ret, ch;
+	if((fp = fopen(path, "r")) == NULL)
+		return -1;
+	while((ret = ReadLineFromFile(fp, line)) >= 0) {
+		if(ret > 0) {
+			// Oversized line, skip the rest of it
+			ctx->oversized++;
+			while((ch = fgetc(fp)) != EOF && ch != '\n')
+				;
+			continue;
+		}
+		ProcessLine(line, strlen(line), ctx);
+	}
+	fclose(fp);
+	return 0;
 }
 
 /**
- *  GPGSAparser                          
+ * RunBuffered
  * <p>
- * This function is used for parsing GPGSA format sentences.
- * <p> 
- * 
- * @param  buf Buffer containing the input string read from the file
- * @param  bufsize Size of the input Buffer
+ * This function parses a file through the block-buffered line reader.
+ * <p>
+ *
+ * @param  path File to parse
+ * @param  ctx Output stream and counters for every line
+ * @return 0 on success, -1 if the file could not be read
  */
-void GPGSAParser(char *buf, unsigned int bufSize) {
-	char auxBuf[20];
-	char* p2;
-	unsigned int index=7;
-	int i;
-	printf("\n\n**********Parsing GPGSA input string**********\n\n");
-	// GSV
-	buf+=7;
-	
-	// Mode Selection
-	if(index>=bufSize)
-	{
-		printf("End of string");
-		
-		return;
+static int RunBuffered(const char *path, RunContext *ctx) {
+	NMEALineReader reader;
+	char *line;
+	size_t len;
+	int fd, ret;
+	if((fd = open(path, O_RDONLY)) < 0)
+		return -1;
+	if(NMEAReaderInit(&reader, fd, 0) < 0) {
+		close(fd);
+		return -1;
 	}
-	if((p2=strchr(buf,','))==NULL) {	
-		
-		printf("Wrong format\n");
-		return;
+	while((ret = NMEAReaderNext(&reader, &line, &len)) > 0) {
+		ctx->offset = reader.offset + (line - reader.buf);
+		ProcessLine(line, len, ctx);
 	}
-	else {
-		if(p2-buf==0) {
-			printf("Mode Selection not specified\n");
-			buf++;
-			index++;
-		}
-		else {
-			index+=(p2-buf+1);
-			strncpy(auxBuf, buf, p2 - buf);
-			auxBuf[p2 - buf] = '\0';
-			buf = p2 + 1;
-			if (strncmp (auxBuf,"A",1)==0)
-				printf("Mode: Auto selection\n");
-			else if (strncmp (auxBuf,"M",1)==0)
-				printf("Mode: Manual Selection\n");
-			else {
-				printf("Invalid Mode\n");
-				return;
+	ctx->oversized += reader.oversized;
+	NMEAReaderFree(&reader);
+	close(fd);
+	return ret;
+}
+
+/**
+ * ParseTimeRange
+ * <p>
+ * This function parses a time range given as "from,to", both hhmmss[.sss].
+ * <p>
+ *
+ * @param  arg Range to parse
+ * @param  from Start of the range as a time of day in milliseconds
+ * @param  to End of the range, inclusive, as a time of day in milliseconds
+ * @return 0 on success, -1 if the range is malformed
+ */
+static int ParseTimeRange(const char *arg, uint32_t *from, uint32_t *to) {
+	const char *comma = strchr(arg, ','), *end = arg + strlen(arg);
+	if(comma == NULL)
+		return -1;
+	if(DecodeTime(arg, comma - arg, end, from) != NMEA_OK || DecodeTime(comma + 1, end - comma - 1, end, to) != NMEA_OK)
+		return -1;
+	return 0;
+}
+
+/*
+ * Places a range of times of day on the log clock: it starts at the first occurrence of
+ * from at or after the first time of the log, and ends at the next occurrence of to,
+ * so a range whose end is earlier than its start crosses midnight.
+ */
+static void SetWindow(RunContext *ctx, uint32_t from, uint32_t to, uint32_t first) {
+	ctx->window = 1;
+	ctx->outside = 1;
+	ctx->from = from + (from < first ? NMEA_DAY_MS : 0);
+	ctx->to = ctx->from - from + to + (to < from ? NMEA_DAY_MS : 0);
+}
+
+/* The search stops once its stride drops below this many bytes and parses the rest */
+#define BISECT_SPAN 4096
+
+/* Largest step of the log clock between two probes for their midnight rollovers to be counted */
+#define BISECT_STEP_MS (60*60*1000)
+
+/**
+ * NextTimedSentence
+ * <p>
+ * This function finds the first timed sentence of a mapped log starting at or after an
+ * offset: it resyncs to the next line start, unless the offset already is one, and
+ * decodes lines from there until one carries a time.
+ * <p>
+ *
+ * @param  data Start of the mapped log
+ * @param  size Size of the log
+ * @param  pos Offset to start searching from
+ * @param  limit Offset at which to give up, lines starting there are not looked at
+ * @param  ms Time of day of the sentence in milliseconds
+ * @param  line Offset of the start of the sentence's line
+ * @return 1 if a timed sentence was found, 0 otherwise
+ */
+static int NextTimedSentence(const char *data, size_t size, size_t pos, size_t limit, uint32_t *ms, size_t *line) {
+	char scratch[MAX_INPUT_LINE_LENGTH+1];
+	const char *nl;
+	if(pos >= limit)
+		return 0;
+	if(pos > 0 && data[pos-1] != '\n') {
+		if((nl = memchr(data + pos, '\n', size - pos)) == NULL)
+			return 0;
+		pos = nl - data + 1;
+	}
+	while(pos < limit) {
+		NMEAScannedLine scan;
+		NMEASentence s;
+		size_t len;
+		nl = memchr(data + pos, '\n', size - pos);
+		len = (nl != NULL ? (size_t)(nl - data) : size) - pos;
+		if(len <= MAX_INPUT_LINE_LENGTH) {
+			NMEAScanLine(data + pos, len, scratch, &scan);
+			if(scan.len > 0 && scan.buf[0] == '$' && scan.errorLoc == 0
+				&& NMEADecodeSentence(scan.buf, scan.len, &scan.fields, scan.type, &s) == NMEA_OK
+				&& NMEASentenceTime(&s, ms)) {
+				*line = pos;
+				return 1;
 			}
 		}
+		pos += len + 1;
 	}
+	return 0;
+}
 
-	// Fix type
-	if(index>=bufSize)
-	{
-		printf("End of string");
-		
-		return;
-	}
-	if((p2=strchr(buf,','))==NULL) {	
-		printf("Wrong format\n");
-		
-		return;
+/**
+ * RunBisect
+ * <p>
+ * This function parses only the sentences of a time range of a log that has no index.
+ * It maps the file for random access and gallops through it by byte offset, probing
+ * the first timed sentence after each stride, so only a few pages are read before the
+ * range. Each probe is placed on the log clock from the previous accepted one with
+ * NMEALogClockAdvance, which counts midnight rollovers, so logs spanning several days
+ * are searched by the same clock as a full pass. A probe is accepted and the stride
+ * doubled only when it is earlier than the range and at most BISECT_STEP_MS from the
+ * previous one, close enough that no rollover can hide between them; otherwise the
+ * stride is halved. When even the smallest stride cannot be placed, the rest is parsed
+ * linearly from the last accepted probe. Times are assumed to increase along the file.
+ * <p>
+ *
+ * @param  path File to parse
+ * @param  from Start of the range as a time of day in milliseconds
+ * @param  to End of the range, inclusive, as a time of day in milliseconds
+ * @param  ctx Output stream and counters for every line
+ * @return 0 on success, -1 if the file could not be mapped
+ */
+static int RunBisect(const char *path, uint32_t from, uint32_t to, RunContext *ctx) {
+	NMEAMappedFile map;
+	NMEALogClock clock;
+	size_t lo = 0, stride = BISECT_SPAN, line, page = sysconf(_SC_PAGESIZE);
+	uint32_t first, ms;
+	uint64_t time;
+	if(NMEAMapFile(path, &map, MADV_RANDOM) < 0)
+		return -1;
+	if(!NextTimedSentence(map.data, map.size, 0, map.size, &first, &line)) {
+		NMEAUnmapFile(&map);
+		return 0;
 	}
-	else {
-		if(p2-buf==0) {
-			printf("Fix type not specified\n");
-			buf++;
-			index++;
+	SetWindow(ctx, from, to, first);
+	memset(&clock, 0, sizeof(clock));
+	time = NMEALogClockAdvance(&clock, first);
+	// Every timed sentence before lo is earlier than the range; the one at lo is at 'time'
+	while(stride >= BISECT_SPAN) {
+		NMEALogClock probe = clock;
+		uint64_t t;
+		if(!NextTimedSentence(map.data, map.size, lo + stride, map.size, &ms, &line)) {
+			stride /= 2;
+			continue;
 		}
-		else {
-			index+=(p2-buf+1);
-			strncpy(auxBuf, buf, p2 - buf);
-			auxBuf[p2 - buf] = '\0';
-			buf = p2 + 1;
-			if (checkdigit(auxBuf,0)<0) {
-				printf("Fix Type must be a number");
-				return;
-			}
-			int q;
-			q=atoi(auxBuf);
-			if (q==1)
-				printf("Fix Type: 'No fix'\n");
-			else if (q == 2)
-				printf("Fix Type: '2D fix'\n");
-			else if (q==3)
-				printf("Fix Type: '3D fix'\n");
-			else {
-				printf("Invalid Fix Type\n");
-				
-				return;
-			}
+		t = NMEALogClockAdvance(&probe, ms);
+		if(t >= ctx->from || t > time + BISECT_STEP_MS || t + BISECT_STEP_MS < time) {
+			stride /= 2;
+			continue;
 		}
+		lo = line;
+		clock = probe;
+		time = t;
+		stride *= 2;
 	}
+	if(lo > 0)
+		ctx->clock = clock;
+	madvise((char *)map.data + lo / page * page, map.size - lo / page * page, MADV_SEQUENTIAL);
+	ProcessLines(map.data + lo, map.size - lo, ctx);
+	NMEAUnmapFile(&map);
+	return 0;
+}
 
-	// PRNs of Satellites
-	for(i=0;i<12;i++) {
-		if(index>=bufSize)
-		{
-			printf("End of string");
-			return;
-		}
-		if((p2=strchr(buf,','))==NULL) {	
-			printf("Wrong format\n");
-			return;
-		}
-		else {
-			if(p2-buf==0) {
-				printf("PRN of Satellite # %d : not specified\n",i);
-				buf++;
-				index++;
-			}
-			else {
-				index+=(p2-buf+1);
-				strncpy(auxBuf, buf, p2 - buf);
-				auxBuf[p2 - buf] = '\0';
-				buf = p2 + 1;
-				if (checkdigit(auxBuf,0)<0) {
-					printf("PRN of Satellite must be a number");
-					return;
-				}
-				printf("PRN of Satellite # %d : %s\n",i,auxBuf);
-			}
-		}
+/**
+ * RunIndexed
+ * <p>
+ * This function parses only the sentences of a time range, starting from the entry of
+ * the sidecar index of the file (the file name followed by ".idx") just before the range
+ * and stopping after it. An index whose stamp does not match the file, left over from a
+ * log since rotated or rewritten, is reported and the range searched for with
+ * RunBisect instead.
+ * <p>
+ *
+ * @param  path File to parse
+ * @param  from Start of the range as a time of day in milliseconds
+ * @param  to End of the range, inclusive, as a time of day in milliseconds
+ * @param  ctx Output stream and counters for every line
+ * @return 0 on success, -1 if the file or its index could not be read
+ */
+static int RunIndexed(const char *path, uint32_t from, uint32_t to, RunContext *ctx) {
+	char indexPath[4096];
+	NMEAMappedFile map, index;
+	NMEAIndexEntry entry;
+	snprintf(indexPath, sizeof(indexPath), "%s.idx", path);
+	if(NMEAMapFile(indexPath, &index, MADV_RANDOM) < 0)
+		return -1;
+	if(NMEAMapFile(path, &map, MADV_SEQUENTIAL) < 0) {
+		NMEAUnmapFile(&index);
+		return -1;
 	}
-	
-	// PDOP
-	if(index>=bufSize)
-	{
-		printf("End of string");
-		
-		return;
+	if(!NMEAIndexMatches(&index, map.data, map.size) || NMEAIndexSeek(&index, 0, &entry) < 0) {
+		NMEAUnmapFile(&index);
+		NMEAUnmapFile(&map);
+		fprintf(stderr, "The index %s was not written for %s as it is now; searching the file without it\n",
+			indexPath, path);
+		return RunBisect(path, from, to, ctx);
 	}
-	if((p2=strchr(buf,','))==NULL) {	
-		printf("Wrong format\n");
-		
-		return;
+	// The first entry is the first timed sentence of the log
+	SetWindow(ctx, from, to, index.size > NMEA_INDEX_HEADER ? Load64LE(index.data + NMEA_INDEX_HEADER) % NMEA_DAY_MS : 0);
+	NMEAIndexSeek(&index, ctx->from, &entry);
+	NMEAUnmapFile(&index);
+	if(entry.offset > map.size) {
+		NMEAUnmapFile(&map);
+		errno = EINVAL;
+		return -1;
 	}
-	else {
-		if(p2-buf==0) {
-			printf("PDOP not specified\n");
-			buf++;
-			index++;
+	if(entry.offset > 0) {
+		ctx->clock.started = 1;
+		ctx->clock.days = entry.time / NMEA_DAY_MS;
+		ctx->clock.last = entry.time % NMEA_DAY_MS;
+	}
+	ProcessLines(map.data + entry.offset, map.size - entry.offset, ctx);
+	NMEAUnmapFile(&map);
+	return 0;
+}
+
+/**
+ * RunMapped
+ * <p>
+ * This function maps the file and parses every line in place, without copying.
+ * <p>
+ *
+ * @param  path File to parse
+ * @param  ctx Output stream and counters for every line
+ * @return 0 on success, -1 if the file could not be mapped
+ */
+static int RunMapped(const char *path, RunContext *ctx) {
+	NMEAMappedFile map;
+	if(NMEAMapFile(path, &map, MADV_SEQUENTIAL) < 0)
+		return -1;
+	ProcessLines(map.data, map.size, ctx);
+	NMEAUnmapFile(&map);
+	return 0;
+}
+
+/* One piece of a parallel run: a range of whole lines and the report produced for it */
+typedef struct {
+	const char *data;
+	size_t size;
+	char *out;
+	size_t outLen;
+	RunContext ctx;
+	int done;
+} ParseChunk;
+
+/*
+ * Chunks are handed to the workers in file order. A worker may run at most 'window'
+ * chunks ahead of the last one written, which bounds the memory held by finished reports.
+ */
+typedef struct {
+	ParseChunk *chunks;
+	size_t nChunks;
+	size_t next;
+	size_t written;
+	size_t window;
+	int format;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+} ChunkQueue;
+
+static void *ParseWorker(void *arg) {
+	ChunkQueue *q = arg;
+	for(;;) {
+		ParseChunk *c;
+		NMEASink sink;
+		FILE *fp;
+		pthread_mutex_lock(&q->lock);
+		while(q->next < q->nChunks && q->next >= q->written + q->window)
+			pthread_cond_wait(&q->cond, &q->lock);
+		if(q->next >= q->nChunks) {
+			pthread_mutex_unlock(&q->lock);
+			return NULL;
 		}
-		else {
-			index+=(p2-buf+1);
-			strncpy(auxBuf, buf, p2 - buf);
-			auxBuf[p2 - buf] = '\0';
-			buf = p2 + 1;
-			if (checkdigit(auxBuf,1)<0) {
-				printf("PDOP must be a number");
-				return;
+		c = &q->chunks[q->next++];
+		pthread_mutex_unlock(&q->lock);
+
+		if((fp = open_memstream(&c->out, &c->outLen)) != NULL) {
+			if(NMEASinkInit(&sink, -1, fp, q->format, 0) == 0) {
+				// The CSV header is written once, by the run's own sink
+				sink.header = 1;
+				c->ctx.out = &sink;
+				ProcessLines(c->data, c->size, &c->ctx);
+				NMEASinkClose(&sink);
+				c->ctx.out = NULL;
 			}
-			printf("PDOP: %s\n", auxBuf);
+			fclose(fp);
 		}
-	}
 
-	// HDOP
-	if(index>=bufSize)
-	{
-		printf("End of string");
-		
-		return;
-	}
-	if((p2=strchr(buf,','))==NULL) {	
-		printf("Wrong format\n");
-		
-		return;
+		pthread_mutex_lock(&q->lock);
+		c->done = 1;
+		pthread_cond_broadcast(&q->cond);
+		pthread_mutex_unlock(&q->lock);
 	}
-	else {
-		if(p2-buf==0) {
-			printf("HDOP not specified\n");
-			buf++;
-			index++;
+}
+
+/**
+ * SplitChunks
+ * <p>
+ * This function cuts a buffer into pieces of roughly chunkSize bytes. Every cut is made
+ * just after a '\n' that is followed by '$', so each piece holds whole sentences.
+ * <p>
+ *
+ * @param  data Buffer to split
+ * @param  size Size of the buffer
+ * @param  chunkSize Target size of a piece
+ * @param  nChunks Set to the number of pieces
+ * @return Array of pieces to be freed by the caller, NULL if out of memory
+ */
+static ParseChunk *SplitChunks(const char *data, size_t size, size_t chunkSize, size_t *nChunks) {
+	size_t max = size / chunkSize + 1, n = 0, pos = 0;
+	ParseChunk *chunks = calloc(max, sizeof(ParseChunk));
+	if(chunks == NULL)
+		return NULL;
+	while(pos < size) {
+		size_t cut = pos + chunkSize;
+		if(cut >= size || n == max - 1) {
+			cut = size;
 		}
 		else {
-			index+=(p2-buf+1);
-			strncpy(auxBuf, buf, p2 - buf);
-			auxBuf[p2 - buf] = '\0';
-			buf = p2 + 1;
-			if (checkdigit(auxBuf,1)<0) {
-				printf("HDOP must be a number");
-				return;
+			const char *p = data + cut - 1;
+			for(;;) {
+				p = memchr(p, '\n', data + size - p);
+				if(p == NULL || p + 1 == data + size || p[1] == '$')
+					break;
+				p++;
 			}
-			printf("HDOP: %s\n", auxBuf);
+			cut = p == NULL ? size : (size_t)(p + 1 - data);
 		}
+		chunks[n].data = data + pos;
+		chunks[n].size = cut - pos;
+		n++;
+		pos = cut;
 	}
+	*nChunks = n;
+	return chunks;
+}
 
-	// VDOP
-	if(index>=bufSize)
-	{
-		printf("End of string");
-		
-		return;
+/**
+ * RunParallel
+ * <p>
+ * This function maps the file, splits it at sentence boundaries and parses the pieces on
+ * a pool of worker threads. Each piece is reported into its own memory stream, and the
+ * reports are written out in file order as soon as they are complete.
+ * <p>
+ *
+ * @param  path File to parse
+ * @param  threads Number of worker threads
+ * @param  ctx Output stream, and counters summed over all pieces
+ * @return 0 on success, -1 if the file could not be mapped or the workers not started
+ */
+static int RunParallel(const char *path, int threads, RunContext *ctx) {
+	NMEAMappedFile map;
+	ChunkQueue q;
+	pthread_t *workers;
+	size_t i;
+	int t, started = 0;
+	if(NMEAMapFile(path, &map, MADV_SEQUENTIAL) < 0)
+		return -1;
+	memset(&q, 0, sizeof(q));
+	q.window = 2 * threads;
+	q.format = ctx->out != NULL ? ctx->out->format : NMEA_FORMAT_TEXT;
+	q.chunks = SplitChunks(map.data, map.size, NMEA_PARALLEL_CHUNK_SIZE, &q.nChunks);
+	workers = malloc(threads * sizeof(pthread_t));
+	if(q.chunks == NULL || workers == NULL) {
+		free(q.chunks);
+		free(workers);
+		NMEAUnmapFile(&map);
+		errno = ENOMEM;
+		return -1;
 	}
-	if((p2=strchr(buf,','))==NULL) {	
-		printf("Wrong format\n");
-		
-		return;
+	pthread_mutex_init(&q.lock, NULL);
+	pthread_cond_init(&q.cond, NULL);
+	for(t=0;t<threads;t++) {
+		if(pthread_create(&workers[t], NULL, ParseWorker, &q) != 0)
+			break;
+		started++;
 	}
-	else {
-		if(p2-buf==0) {
-			printf("VDOP not specified\n");
-			buf++;
-			index++;
-		}
-		else {
-			index+=(p2-buf+1);
-			strncpy(auxBuf, buf, p2 - buf);
-			auxBuf[p2 - buf] = '\0';
-			buf = p2 + 1;
-			if (checkdigit(auxBuf,1)<0) {
-				printf("VDOP must be a number");
-				return;
-			}
-			printf("VDOP: %s\n", auxBuf);
+	if(started == 0) {
+		/* no worker could be started; parse on this thread instead */
+		q.window = q.nChunks + 1;
+		ParseWorker(&q);
+	}
+
+	for(i=0;i<q.nChunks;i++) {
+		ParseChunk *c = &q.chunks[i];
+		pthread_mutex_lock(&q.lock);
+		while(!c->done)
+			pthread_cond_wait(&q.cond, &q.lock);
+		pthread_mutex_unlock(&q.lock);
+
+		if(c->out != NULL && ctx->out != NULL) {
+			if(q.format == NMEA_FORMAT_CSV && c->outLen > 0 && !ctx->out->header)
+				CsvHeader(ctx->out);
+			NMEASinkWrite(ctx->out, c->out, c->outLen);
 		}
+		free(c->out);
+		ctx->sentences += c->ctx.sentences;
+		ctx->rejected += c->ctx.rejected;
+		ctx->garbage += c->ctx.garbage;
+		ctx->oversized += c->ctx.oversized;
+
+		pthread_mutex_lock(&q.lock);
+		q.written++;
+		pthread_cond_broadcast(&q.cond);
+		pthread_mutex_unlock(&q.lock);
 	}
-	// Checksum
-	if(buf[0]!='*')
-		printf("Not valid GPGSA sentence format. Terminal '*' missing");
-	else
-		printf("\n**********GPGSA format string parsing complete**********\n");
-	
+
+	for(t=0;t<started;t++)
+		pthread_join(workers[t], NULL);
+	pthread_mutex_destroy(&q.lock);
+	pthread_cond_destroy(&q.cond);
+	free(workers);
+	free(q.chunks);
+	NMEAUnmapFile(&map);
+	return 0;
+}
+
+static void FramedSentence(void *ctx, const char *sentence, size_t len) {
+	ProcessLine(sentence, len, ctx);
 }
 
 /**
- *  GPGLLparser                          
+ * RunStream
  * <p>
- * This function is used for parsing GPGLL format sentences.
- * <p> 
- * 
- * @param  buf Buffer containing the input string read from the file
- * @param  bufsize Size of the input Buffer
+ * This function parses a live byte stream, such as a serial port or socket, through the
+ * resumable framer, handing each sentence on as soon as its line end arrives.
+ * <p>
+ *
+ * @param  path Device or file to read, "-" for standard input
+ * @param  ctx Output stream and counters for every sentence
+ * @return 0 on success, -1 if the stream could not be read
  */
+static int RunStream(const char *path, RunContext *ctx) {
+	NMEAFramer framer;
+	char chunk[4096];
+	ssize_t got;
+	int fd = strcmp(path, "-") == 0 ? STDIN_FILENO : open(path, O_RDONLY | O_NOCTTY);
+	if(fd < 0)
+		return -1;
+	NMEAFramerInit(&framer);
+	while((got = read(fd, chunk, sizeof(chunk))) != 0) {
+		if(got < 0) {
+			if(errno == EINTR)
+				continue;
+			break;
+		}
+		NMEAFramerPush(&framer, chunk, got, FramedSentence, ctx);
+		if(ctx->out != NULL)
+			NMEASinkFlush(ctx->out);
+	}
+	NMEAFramerFinish(&framer, FramedSentence, ctx);
+	ctx->oversized += framer.overflows;
+	if(framer.resyncs > 0 || framer.discarded > 0)
+		fprintf(stderr, "Framer dropped %lu truncated sentences and %lu bytes outside sentences\n",
+			framer.resyncs, framer.discarded);
+	if(fd != STDIN_FILENO)
+		close(fd);
+	return got < 0 ? -1 : 0;
+}
 
-void GPGLLParser(char *buf, unsigned int bufSize)
-{
-	char auxBuf[20];
-	char* p2;
-	char* p3;
-	unsigned int index=7;
+/* Reader side of a ring run: the input, the framer cutting it into sentences and the ring they go to */
+typedef struct {
+	int fd;
+	NMEARing *ring;
+	NMEAFramer framer;
+	int error;
+} RingReader;
 
-	printf("\n**********Parsing GPGLL input string**********\n\n");
-	// GGA
-	buf+=7;
-	
-	// Latitude
-	if(index>=bufSize)
-	{
-		
-		printf("End of string");
-		return;
-	}
-	if((p2=strchr(buf,','))==NULL) {	
-		
-		printf("Wrong format\n");
-		return;
-	}
-	else {
-		if(p2-buf==0) {
-			printf("Latitude not specified\n");
-			buf++;
-			index++;
-			p3=strchr(buf,',');	
-			if(p3-buf==0) {
-				buf++;
-				index++;
-			}
-			else {
-				buf=buf+3;
-				index+=3;
-			}
-		}
-		else {
-			index+=(p2-buf+1);
-			strncpy(auxBuf, buf, p2 - buf);
-			auxBuf[p2 - buf] = '\0';
-			buf = p2 + 1;
-			if (checkdigit(auxBuf,1)<0) {
-				printf("Latitude must be a number");
-				return;
-			}
-			if((p2 = strchr(auxBuf, '.')) == NULL) {
-				return;
-			}
-			if(p2-auxBuf < 2){
-				return;
-			}
-			int latitude = atoi(auxBuf);
-			if (latitude/100>90 || latitude/100<0) {
-				printf("Wrong value of latitude. Latitude measurements range from 0B0 to 90B0.");
-				return;
-			}
-			int min = latitude%100;
-			if (min>59) {
-				printf("Wrong value of latitude. Minutes cannot be greater than 59");
-				return;
-			}
-			printf("latitude: %d deg %d%s' ", latitude/100,min,p2);
-			if((p2 = strchr(buf, ',')) == NULL)
-				printf("Wrong format");
-			if(p2 - buf != 1) {
-				printf("\nNot valid GPGGA sentence format, direction missing\n");
-				return;
-			}
-			if(*buf == 'S')
-				printf("S\n");
-			else if(*buf == 'N')
-				printf("N\n");
-			else {
-				printf("Wrong direction. Possible values 'N' or 'S'");
-				return;
-			}
-			index+=(p2-buf+1);
-			buf = p2 + 1;
+#define RING_READ_SIZE (64*1024)
+
+static void RingSentence(void *ctx, const char *sentence, size_t len) {
+	NMEARing *ring = ctx;
+	NMEARingSlot *slot = NMEARingReserve(ring);
+	memcpy(slot->text, sentence, len);
+	slot->len = len;
+	NMEARingCommit(ring);
+}
+
+static void *RingReaderThread(void *arg) {
+	RingReader *reader = arg;
+	char chunk[RING_READ_SIZE];
+	ssize_t got;
+	while((got = read(reader->fd, chunk, sizeof(chunk))) != 0) {
+		if(got < 0) {
+			if(errno == EINTR)
+				continue;
+			reader->error = errno;
+			break;
 		}
+		NMEAFramerPush(&reader->framer, chunk, got, RingSentence, reader->ring);
+		// the next read may block on a live stream
+		NMEARingPublish(reader->ring);
 	}
-	
-	// Longitude
-	if(index>=bufSize)
-	{
-		printf("End of string");
-		return;
+	NMEAFramerFinish(&reader->framer, RingSentence, reader->ring);
+	NMEARingClose(reader->ring);
+	return NULL;
+}
+
+/**
+ * RunRing
+ * <p>
+ * This function reads and frames the input on a reader thread, which passes the sentences
+ * to this thread through a lock-free ring, so a slow read and a slow parse overlap instead
+ * of stalling each other. Output is flushed whenever the ring runs empty. Ring occupancy
+ * and the stalls of both threads are reported on stderr for sizing the ring.
+ * <p>
+ *
+ * @param  path Device or file to read, "-" for standard input
+ * @param  slots Slots in the ring, 0 for NMEA_RING_SLOTS
+ * @param  ctx Output stream and counters for every sentence
+ * @return 0 on success, -1 if the input could not be read or the reader not started
+ */
+static int RunRing(const char *path, size_t slots, RunContext *ctx) {
+	NMEARing ring;
+	RingReader reader;
+	pthread_t thread;
+	const NMEARingSlot *slot;
+	int fd = strcmp(path, "-") == 0 ? STDIN_FILENO : open(path, O_RDONLY | O_NOCTTY);
+	if(fd < 0)
+		return -1;
+	memset(&reader, 0, sizeof(reader));
+	reader.fd = fd;
+	reader.ring = &ring;
+	NMEAFramerInit(&reader.framer);
+	if(NMEARingInit(&ring, slots) < 0 || (reader.error = pthread_create(&thread, NULL, RingReaderThread, &reader)) != 0) {
+		NMEARingFree(&ring);
+		if(fd != STDIN_FILENO)
+			close(fd);
+		errno = reader.error != 0 ? reader.error : ENOMEM;
+		return -1;
 	}
-	if((p2=strchr(buf,','))==NULL) {	
-		printf("Wrong format\n");
-		return;
+	while((slot = NMEARingNext(&ring)) != NULL) {
+		ProcessLine(slot->text, slot->len, ctx);
+		if(ctx->out != NULL && NMEARingAvailable(&ring) == 0)
+			NMEASinkFlush(ctx->out);
 	}
-	else {
-		if(p2-buf==0) {
-			printf("Latitude not specified\n");
-			buf++;
-			index++;
-			p3=strchr(buf,',');	
-			if(p3-buf==0) {
-				buf++;
-				index++;
-			}
-			else {
-				buf=buf+3;
-				index+=3;
-			}
-		}
-		else {
-			if(buf== NULL) return;
-			index+=(p2-buf+1);
-			strncpy(auxBuf, buf, p2 - buf);
-			auxBuf[p2 - buf] = '\0';
-			buf = p2 + 1;
-			if (checkdigit(auxBuf,1)<0) {
-				printf("Longitude must be a number");
-				return;
-			}
-			if((p2 = strchr(auxBuf, '.')) == NULL)
-				return;
-			if(p2-auxBuf < 2)
-				return;
-			int longitude = atoi(auxBuf);
-			if (longitude/100>180 || longitude/100<0) {
-				printf("Wrong value of longitude. Longitude measurements range from 0B0 to 180B0.");
-				return;
-			}
-			int min = longitude%100;
-			if (min>59) {
-				printf("Wrong value of longitude. Minutes cannot be greater than 59");
-				return;
-			}
-			printf("longitude: %d deg %d%s' ", longitude/100,min%100,p2);
-			if((p2 = strchr(buf, ',')) == NULL)
-				printf("Wrong format");
-			if(p2 - buf != 1) {
-				printf("\nNot valid GPGGA sentence format, direction missing\n");
-				return;
-			}
-			if(*buf == 'E')
-				printf("E\n");
-			else if(*buf == 'W')
-				printf("W\n");
-			else {
-				printf("Wrong direction. Possible values 'E' or 'W'");
-				return;
-			}
-			index+=(p2-buf+1);
-			buf = p2 + 1;
+	pthread_join(thread, NULL);
+	ctx->oversized += reader.framer.overflows;
+	if(reader.framer.resyncs > 0 || reader.framer.discarded > 0)
+		fprintf(stderr, "Framer dropped %lu truncated sentences and %lu bytes outside sentences\n",
+			reader.framer.resyncs, reader.framer.discarded);
+	fprintf(stderr, "Ring of %zu slots held %.1f sentences on average and %zu at most; the reader waited on a full ring %lu times "
+		"and the parser on an empty one %lu times; %lu batches published\n",
+		ring.size, ring.samples > 0 ? (double)ring.occupancy / ring.samples : 0.0, ring.peak,
+		ring.fullStalls, ring.emptyStalls, ring.batches);
+	NMEARingFree(&ring);
+	if(fd != STDIN_FILENO)
+		close(fd);
+	if(reader.error != 0) {
+		errno = reader.error;
+		return -1;
+	}
+	return 0;
+}
+
+static double NowSeconds(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*
+ * Pipelined run, selected with -p. Framing, validation (the fused sanitize/check/tokenize
+ * scan), decoding and output are stages that can each run on a thread of their own,
+ * pinned to its own core, or be fused into fewer threads. The threads share one ring of
+ * items: each owns a cursor, works on the items between its cursor and that of the
+ * thread before it, and publishes its cursor every NMEA_RING_BATCH items or before it
+ * waits, so every pair of neighbouring threads is joined by a bounded lock-free queue.
+ * The framing thread may fill items up to one ring ahead of the last thread's cursor.
+ */
+enum {
+	STAGE_FRAME = 1<<0,
+	STAGE_VALIDATE = 1<<1,
+	STAGE_DECODE = 1<<2,
+	STAGE_OUTPUT = 1<<3
+};
+
+#define PIPELINE_STAGES 4
+
+static const char pipelineStageLetters[PIPELINE_STAGES] = { 'f', 'v', 'd', 'o' };
+static const char *pipelineStageNames[PIPELINE_STAGES] = { "frame", "validate", "decode", "output" };
+
+/* One sentence on its way through the pipeline; the scan may point into text or scratch */
+typedef struct {
+	NMEAScannedLine scan;
+	NMEASentence sentence;
+	NMEAStatus status;
+	uint32_t len;
+	char text[MAX_INPUT_LINE_LENGTH+1];
+	char scratch[MAX_INPUT_LINE_LENGTH+1];
+} PipelineItem;
+
+typedef struct Pipeline Pipeline;
+
+/* A thread of the pipeline: its published cursor, then its private state and time spent waiting */
+typedef struct {
+	size_t done __attribute__((aligned(NMEA_CACHE_LINE)));
+	int finished;
+	size_t next __attribute__((aligned(NMEA_CACHE_LINE)));
+	size_t limit;
+	unsigned int stages;
+	int cpu;
+	unsigned long items;
+	double start;
+	double elapsed;
+	double starved;
+	double blocked;
+	Pipeline *pipeline;
+	pthread_t thread;
+} PipelineThread;
+
+struct Pipeline {
+	PipelineItem *items;
+	size_t size;
+	PipelineThread threads[PIPELINE_STAGES];
+	unsigned int nThreads;
+	RunContext *ctx;
+	NMEAFramer framer;
+	int fd;
+	int error;
+};
+
+/**
+ * ParsePipelineSpec
+ * <p>
+ * This function reads the grouping of stages into threads: the letters f (frame),
+ * v (validate), d (decode) and o (output) in that order, with a comma wherever a new
+ * thread starts. "f,v,d,o" runs every stage on its own thread, "fv,do" runs two.
+ * <p>
+ *
+ * @param  spec Grouping given with -p
+ * @param  stages Filled with the stages of each thread
+ * @param  nThreads Set to the number of threads
+ * @return 0 on success, -1 if the grouping is malformed
+ */
+static int ParsePipelineSpec(const char *spec, unsigned int *stages, unsigned int *nThreads) {
+	unsigned int stage = 0;
+	*nThreads = 1;
+	stages[0] = 0;
+	for(;*spec != '\0';spec++) {
+		if(*spec == ',') {
+			if(stages[*nThreads - 1] == 0 || *nThreads == PIPELINE_STAGES)
+				return -1;
+			stages[(*nThreads)++] = 0;
 		}
+		else if(stage < PIPELINE_STAGES && *spec == pipelineStageLetters[stage])
+			stages[*nThreads - 1] |= 1u << stage++;
+		else
+			return -1;
 	}
+	return stage == PIPELINE_STAGES ? 0 : -1;
+}
 
-	// Time
-	if(index>=bufSize)
-	{
-		printf("End of string");
-		return;
-	}
-	if((p2=strchr(buf,','))==NULL) {	
-		printf("Wrong format\n");
-		return;
-	}
-	else {
-		if(p2-buf==0) {
-			printf("Fix time not specified\n");
-			buf++;
-			index++;
-		}
-		else if (p2-buf!=6) {
-			printf("Incorrect time format\n");
+/* Runs the given stages, other than framing, on one item */
+static void PipelineRunStages(Pipeline *p, unsigned int stages, PipelineItem *item) {
+	if(stages & STAGE_VALIDATE)
+		NMEAScanLine(item->text, item->len, item->scratch, &item->scan);
+	if((stages & STAGE_DECODE) && item->scan.len > 0 && item->scan.buf[0] == '$' && item->scan.errorLoc == 0)
+		item->status = NMEADecodeSentence(item->scan.buf, item->scan.len, &item->scan.fields, item->scan.type, &item->sentence);
+	if(stages & STAGE_OUTPUT) {
+		if(item->scan.len == 0)
 			return;
+		if(item->scan.buf[0] != '$')
+			p->ctx->garbage++;
+		else
+			ReportLine(&item->scan, item->status, &item->sentence, p->ctx);
+	}
+}
+
+/* Publishes the cursor of a thread, making the items it finished visible to the next one */
+static inline void PipelinePublish(PipelineThread *t) {
+	__atomic_store_n(&t->done, t->next, __ATOMIC_RELEASE);
+}
+
+/* Moves a thread past the item it has just finished */
+static inline void PipelineAdvance(PipelineThread *t) {
+	t->items++;
+	if(++t->next % NMEA_RING_BATCH == 0)
+		PipelinePublish(t);
+}
+
+/* Framing thread: returns the item to fill next, waiting while the ring is full */
+static PipelineItem *PipelineReserve(Pipeline *p, PipelineThread *t) {
+	PipelineThread *last = &p->threads[p->nThreads - 1];
+	unsigned int spins = 0;
+	double start;
+	if(t->next - t->limit >= p->size) {
+		PipelinePublish(t);
+		t->limit = __atomic_load_n(&last->done, __ATOMIC_ACQUIRE);
+		if(t->next - t->limit >= p->size) {
+			start = NowSeconds();
+			do {
+				RingWait(&spins);
+				t->limit = __atomic_load_n(&last->done, __ATOMIC_ACQUIRE);
+			} while(t->next - t->limit >= p->size);
+			t->blocked += NowSeconds() - start;
 		}
-		else {
-			index+=(p2-buf+1);
-			printf("Fix taken at ");
-			strncpy(auxBuf, buf, 2);
-			auxBuf[2] = '\0';
-			if (checkdigit(auxBuf,0)<0) {
-				printf("Time must be a number");
-				return;
-			}
-			int hour = atoi(auxBuf);
-			if (hour>23) {
-				printf("Wrong value of time. Hour cannot be greater than 23");
-				return;
-			}
-			buf += 2;
-			printf("%s:",auxBuf);
-			strncpy(auxBuf, buf, 2);
-			auxBuf[2] = '\0';
-			buf += 2;
-			int min = atoi(auxBuf);
-			if (min>59) {
-				printf("Wrong value of time. Minutes cannot be greater than 59");
-				return;
-			}
-			printf("%s:",auxBuf);
-			strncpy(auxBuf, buf, 2);
-			auxBuf[2] = '\0';
-			buf = p2 + 1;
-			int sec = atoi(auxBuf);
-			if (sec>59) {
-				printf("Wrong value of time. Seconds cannot be greater than 59");
-				return;
-			}
-			printf("%s UTC\n",auxBuf);
+	}
+	return &p->items[t->next & (p->size - 1)];
+}
+
+/* Other threads: returns the number of items ready, waiting for some; 0 once the previous thread has finished */
+static size_t PipelineAcquire(Pipeline *p, PipelineThread *t) {
+	PipelineThread *prev = t - 1;
+	unsigned int spins = 0;
+	double start;
+	if(t->next == t->limit)
+		t->limit = __atomic_load_n(&prev->done, __ATOMIC_ACQUIRE);
+	if(t->next != t->limit)
+		return t->limit - t->next;
+	PipelinePublish(t);
+	if((t->stages & STAGE_OUTPUT) && p->ctx->out != NULL)
+		NMEASinkFlush(p->ctx->out);
+	start = NowSeconds();
+	while(t->next == t->limit) {
+		if(__atomic_load_n(&prev->finished, __ATOMIC_ACQUIRE)) {
+			t->limit = __atomic_load_n(&prev->done, __ATOMIC_ACQUIRE);
+			break;
 		}
+		RingWait(&spins);
+		t->limit = __atomic_load_n(&prev->done, __ATOMIC_ACQUIRE);
 	}
+	t->starved += NowSeconds() - start;
+	return t->limit - t->next;
+}
 
-	// Status
-	if(index>=bufSize)
-	{
-		printf("End of string");
-		return;
+static void PipelineSentence(void *ctx, const char *sentence, size_t len) {
+	Pipeline *p = ctx;
+	PipelineThread *t = &p->threads[0];
+	PipelineItem *item = PipelineReserve(p, t);
+	memcpy(item->text, sentence, len);
+	item->len = len;
+	PipelineRunStages(p, t->stages, item);
+	PipelineAdvance(t);
+}
+
+/* Pins the calling thread to the n-th core it is allowed on, modulo their number */
+static int PinThread(unsigned int n) {
+#ifdef __linux__
+	cpu_set_t allowed, one;
+	int cpu, count;
+	if(sched_getaffinity(0, sizeof(allowed), &allowed) != 0 || (count = CPU_COUNT(&allowed)) == 0)
+		return -1;
+	n %= count;
+	for(cpu=0;cpu<CPU_SETSIZE;cpu++) {
+		if(CPU_ISSET(cpu, &allowed) && n-- == 0) {
+			CPU_ZERO(&one);
+			CPU_SET(cpu, &one);
+			return pthread_setaffinity_np(pthread_self(), sizeof(one), &one) == 0 ? cpu : -1;
+		}
 	}
-	if((p2=strchr(buf,','))==NULL) {	
-		printf("Wrong format\n");
-		return;
+#else
+	(void)n;
+#endif
+	return -1;
+}
+
+/* First thread: reads the input and frames it into items, running its other stages on each */
+static void PipelineFrame(Pipeline *p, PipelineThread *t) {
+	char chunk[RING_READ_SIZE];
+	ssize_t got;
+	double start;
+	for(;;) {
+		start = NowSeconds();
+		got = read(p->fd, chunk, sizeof(chunk));
+		t->starved += NowSeconds() - start;
+		if(got == 0)
+			break;
+		if(got < 0) {
+			if(errno == EINTR)
+				continue;
+			p->error = errno;
+			break;
+		}
+		NMEAFramerPush(&p->framer, chunk, got, PipelineSentence, p);
+		// the next read may block on a live stream
+		PipelinePublish(t);
+		if((t->stages & STAGE_OUTPUT) && p->ctx->out != NULL)
+			NMEASinkFlush(p->ctx->out);
 	}
+	NMEAFramerFinish(&p->framer, PipelineSentence, p);
+}
+
+static void *PipelineWorker(void *arg) {
+	PipelineThread *t = arg;
+	Pipeline *p = t->pipeline;
+	size_t n;
+	t->cpu = PinThread(t - p->threads);
+	t->start = NowSeconds();
+	if(t == &p->threads[0])
+		PipelineFrame(p, t);
 	else {
-		if(p2-buf==0) {
-			printf("Status not specified\n");
-			buf++;
-			index++;
-		}
-		else {
-			index+=(p2-buf+1);
-			strncpy(auxBuf, buf, p2 - buf);
-			auxBuf[p2 - buf] = '\0';
-			buf = p2 + 1;
-			if (strncmp (auxBuf,"A",1)==0)
-				printf("Status: Data Valid\n");
-			else if (strncmp (auxBuf,"V",1)==0)
-				printf("Status: Void\n");
-			else {
-				printf("Invalid Status\n");
-				return;
+		while((n = PipelineAcquire(p, t)) > 0) {
+			while(n-- > 0) {
+				PipelineRunStages(p, t->stages, &p->items[t->next & (p->size - 1)]);
+				PipelineAdvance(t);
 			}
 		}
 	}
+	PipelinePublish(t);
+	__atomic_store_n(&t->finished, 1, __ATOMIC_RELEASE);
+	t->elapsed = NowSeconds() - t->start;
+	return NULL;
+}
 
-	// Checksum
-	if(buf[0]!='*')
-		printf("Not valid GPGLL sentence format. Terminal '*' missing");
-	else
-		printf("\n**********GPGLL format string parsing complete**********\n");
+/* Prints the stages, core, items and share of time busy or waiting of every pipeline thread */
+static void PipelineReport(const Pipeline *p) {
+	unsigned int i, k;
+	fprintf(stderr, "Pipeline of %u threads over a ring of %zu items\n", p->nThreads, p->size);
+	fprintf(stderr, "thread  core  stages                           items   busy  waiting for input  waiting for room\n");
+	for(i=0;i<p->nThreads;i++) {
+		const PipelineThread *t = &p->threads[i];
+		char names[64] = "";
+		double elapsed = t->elapsed > 0 ? t->elapsed : 1;
+		for(k=0;k<PIPELINE_STAGES;k++) {
+			if(t->stages & (1u<<k)) {
+				if(names[0] != '\0')
+					strcat(names, "+");
+				strcat(names, pipelineStageNames[k]);
+			}
+		}
+		fprintf(stderr, "%6u  %4d  %-28s  %9lu  %5.1f%%  %16.1f%%  %15.1f%%\n", i, t->cpu, names, t->items,
+			100 * (elapsed - t->starved - t->blocked) / elapsed, 100 * t->starved / elapsed, 100 * t->blocked / elapsed);
+	}
 }
 
 /**
- *  GPGSVparser                          
+ * RunPipeline
  * <p>
- * This function is used for parsing GPGSV format sentences.
- * <p> 
- * 
- * @param  buf Buffer containing the input string read from the file
- * @param  bufsize Size of the input Buffer
+ * This function parses a file or live stream in a pipeline of up to four threads, each
+ * pinned to a core and running one or more of the stages frame, validate, decode and
+ * output on every sentence. Waiting for input covers read() on the first thread and the
+ * previous thread on the others; only the first thread ever waits for room in the ring.
+ * The share of time each thread spends busy, reported on stderr, shows the bottleneck.
+ * <p>
+ *
+ * @param  path Device or file to read, "-" for standard input
+ * @param  stages Stages of each thread, as filled by ParsePipelineSpec
+ * @param  nThreads Number of threads
+ * @param  ctx Output stream and counters for every sentence
+ * @return 0 on success, -1 if the input could not be read or the threads not started
  */
-
-void GPGSVParser(char *buf, unsigned int bufSize) {
-	char auxBuf[20];
-	char* p2;
-	unsigned int index=7;
-	int i;
-	printf("\n\n**********Parsing GPGSV input string**********\n\n");
-	// GSV
-	buf+=7;
-	
-	// Total number of messages of this type in this cycle
-	if(index>=bufSize)
-	{
-		printf("End of string");
-		return;
+static int RunPipeline(const char *path, const unsigned int *stages, unsigned int nThreads, RunContext *ctx) {
+	Pipeline p;
+	unsigned int i, k;
+	int fd = strcmp(path, "-") == 0 ? STDIN_FILENO : open(path, O_RDONLY | O_NOCTTY);
+	if(fd < 0)
+		return -1;
+	memset(&p, 0, sizeof(p));
+	p.size = NMEA_RING_SLOTS;
+	p.nThreads = nThreads;
+	p.ctx = ctx;
+	p.fd = fd;
+	NMEAFramerInit(&p.framer);
+	if(posix_memalign((void **)&p.items, NMEA_CACHE_LINE, p.size * sizeof(PipelineItem)) != 0) {
+		if(fd != STDIN_FILENO)
+			close(fd);
+		errno = ENOMEM;
+		return -1;
 	}
-	if((p2=strchr(buf,','))==NULL) {	
-		printf("Wrong format\n");
-		return;
+	for(i=0;i<nThreads;i++) {
+		p.threads[i].stages = stages[i];
+		p.threads[i].pipeline = &p;
 	}
-	else {
-		if(p2-buf==0) {
-			printf("Total number of messages not specified\n");
-			return;
-		}
-		else {
-			index+=(p2-buf+1);
-			strncpy(auxBuf, buf, p2 - buf);
-			auxBuf[p2 - buf] = '\0';
-			buf = p2 + 1;
-			if (checkdigit(auxBuf,0)<0) {
-				printf("Total number of messages must be a number");
-				return;
-			}
-			printf("Total number of messages of this type in this cycle: %s\n", auxBuf);
+	// last thread first, so that a failure leaves only threads that see their input finish
+	for(i=nThreads;i-->0;) {
+		if((p.error = pthread_create(&p.threads[i].thread, NULL, PipelineWorker, &p.threads[i])) != 0) {
+			for(k=0;k<=i;k++)
+				__atomic_store_n(&p.threads[k].finished, 1, __ATOMIC_RELEASE);
+			break;
 		}
 	}
-	// Message Number
-	if(index>=bufSize)
-	{
-		printf("End of string");
-		
-		return;
+	for(k=i+1;k<nThreads;k++)
+		pthread_join(p.threads[k].thread, NULL);
+	ctx->oversized += p.framer.overflows;
+	if(p.framer.resyncs > 0 || p.framer.discarded > 0)
+		fprintf(stderr, "Framer dropped %lu truncated sentences and %lu bytes outside sentences\n",
+			p.framer.resyncs, p.framer.discarded);
+	if(p.error == 0)
+		PipelineReport(&p);
+	free(p.items);
+	if(fd != STDIN_FILENO)
+		close(fd);
+	if(p.error != 0) {
+		errno = p.error;
+		return -1;
 	}
-	if((p2=strchr(buf,','))==NULL) {	
-		printf("Wrong format\n");
-		
-		return;
+	return 0;
+}
+
+/*
+ * Multiplexed run, selected with -l. Any number of receivers are read on this thread
+ * through one epoll set: files, FIFOs, ptys and devices given by path, "-" for stdin,
+ * "unix:path" to accept connections on a UNIX stream socket and "tcp:port" to accept
+ * them on 127.0.0.1. Every stream, including every accepted connection, gets an ID
+ * and a framer of its own, so sentences split across reads of one stream are put back
+ * together whatever arrives from the others in between.
+ */
+
+/* Port of a "tcp:port" source: 1 to 65535 with nothing after it, -1 if it is not one */
+static int TcpSourcePort(const char *spec) {
+	char *end;
+	long port;
+	if(strncmp(spec, "tcp:", 4) != 0)
+		return -1;
+	errno = 0;
+	port = strtol(spec + 4, &end, 10);
+	if(errno != 0 || end == spec + 4 || *end != '\0' || port < 1 || port > 65535)
+		return -1;
+	return (int)port;
+}
+
+#ifdef __linux__
+
+#define MUX_MAX_EVENTS 256
+
+typedef struct {
+	int fd;
+	int listener;
+	int plain;
+	unsigned int index;
+	unsigned int id;
+	char name[128];
+	NMEAFramer framer;
+} MuxStream;
+
+typedef struct {
+	int epfd;
+	unsigned int nextId;
+	unsigned int open;
+	unsigned int listeners;
+	MuxStream **streams;
+	unsigned int nStreams;
+	unsigned int nPlain;
+	unsigned long dropped;
+	unsigned long truncated;
+} Mux;
+
+static volatile sig_atomic_t muxStop;
+
+static void MuxSignal(int sig) {
+	(void)sig;
+	muxStop = 1;
+}
+
+/* Adds a stream to the epoll set; regular files, which epoll refuses, are read whenever the loop comes round */
+static MuxStream *MuxAdd(Mux *m, int fd, int listener, const char *name) {
+	struct epoll_event ev;
+	MuxStream **streams = realloc(m->streams, (m->nStreams + 1) * sizeof(MuxStream *));
+	MuxStream *s;
+	if(streams == NULL)
+		return NULL;
+	m->streams = streams;
+	if((s = calloc(1, sizeof(MuxStream))) == NULL)
+		return NULL;
+	s->fd = fd;
+	s->listener = listener;
+	s->id = listener ? 0 : ++m->nextId;
+	snprintf(s->name, sizeof(s->name), "%s", name);
+	NMEAFramerInit(&s->framer);
+	ev.events = EPOLLIN;
+	ev.data.ptr = s;
+	if(epoll_ctl(m->epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+		if(errno != EPERM || listener) {
+			free(s);
+			return NULL;
+		}
+		s->plain = 1;
+		m->nPlain++;
 	}
+	s->index = m->nStreams;
+	m->streams[m->nStreams++] = s;
+	if(listener)
+		m->listeners++;
 	else {
-		if(p2-buf==0) {
-			printf("Message number not specified\n");
-			
-			return;
-		}
-		else {
-			index+=(p2-buf+1);
-			strncpy(auxBuf, buf, p2 - buf);
-			auxBuf[p2 - buf] = '\0';
-			buf = p2 + 1;
-			if (checkdigit(auxBuf,0)<0) {
-				printf("Message number must be a number");
-				return;
-			}
-			printf("Message number: %s\n", auxBuf);
-		}
+		m->open++;
+		fprintf(stderr, "Source %u: %s\n", s->id, s->name);
 	}
+	return s;
+}
 
-	// Total number of Satellites in view
-	if(index>=bufSize)
-	{
-		printf("End of string");
-		
-		return;
-	}
-	if((p2=strchr(buf,','))==NULL) {	
-		printf("Wrong format\n");
-		
-		return;
+/* Flushes the framer of a stream that ended or a listener being shut, reports it and frees it */
+static void MuxClose(Mux *m, MuxStream *s, RunContext *ctx) {
+	if(s->listener) {
+		m->listeners--;
+		if(strncmp(s->name, "unix:", 5) == 0)
+			unlink(s->name + 5);
 	}
 	else {
-		if(p2-buf==0) {
-			printf("Number of Satellites not specified\n");
-			buf++;
-			index++;
-		}
-		else {
-			index+=(p2-buf+1);
-			strncpy(auxBuf, buf, p2 - buf);
-			auxBuf[p2 - buf] = '\0';
-			buf = p2 + 1;
-			if (checkdigit(auxBuf,0)<0) {
-				printf("Number of Satellites must be a number");
-				return;
-			}
-			int q=atoi(auxBuf);
-			if (q<0)
-			{
-				printf("Number of satellites in view canot be negative'\n");
-				
-				return;
-			}
-			if (q>12)
-			{
-				printf("Number of satellites in view canot be greater than 12'\n");
-								
-				return;
-			}
-			printf("Number of satellites being tracked: %d\n", q);
-		}
+		ctx->source = s->id;
+		NMEAFramerFinish(&s->framer, FramedSentence, ctx);
+		ctx->oversized += s->framer.overflows;
+		m->truncated += s->framer.resyncs;
+		m->dropped += s->framer.discarded;
+		fprintf(stderr, "Source %u closed after %lu sentences\n", s->id, s->framer.sentences);
+		m->open--;
+	}
+	if(s->plain)
+		m->nPlain--;
+	else
+		epoll_ctl(m->epfd, EPOLL_CTL_DEL, s->fd, NULL);
+	if(s->fd != STDIN_FILENO)
+		close(s->fd);
+	m->streams[s->index] = m->streams[--m->nStreams];
+	m->streams[s->index]->index = s->index;
+	free(s);
+}
+
+/* Reads what a stream has ready and frames it; returns 0 when the stream has ended */
+static int MuxRead(MuxStream *s, char *buf, size_t size, RunContext *ctx) {
+	ssize_t got = read(s->fd, buf, size);
+	if(got < 0)
+		// a pty whose other side has closed reports EIO
+		return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+	if(got == 0)
+		return 0;
+	ctx->source = s->id;
+	NMEAFramerPush(&s->framer, buf, got, FramedSentence, ctx);
+	return 1;
+}
+
+/* Accepts every pending connection of a listening socket as a new stream */
+static void MuxAccept(Mux *m, MuxStream *l) {
+	char name[64];
+	int fd;
+	while((fd = accept4(l->fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+		snprintf(name, sizeof(name), "%.40s connection %u", l->name, m->nextId + 1);
+		if(MuxAdd(m, fd, 0, name) == NULL)
+			close(fd);
 	}
+}
 
-	for(i=0;i<4;i++)
-	{
-		printf("Information about SV # %d\n",i);
-		if(index>=bufSize)
-		{
-			printf("End of string");
-			
-			return;
+/* Opens a source given on the command line: a listening socket, stdin or a path */
+static int MuxOpen(Mux *m, const char *spec) {
+	int fd, port, one = 1;
+	if(strncmp(spec, "unix:", 5) == 0) {
+		struct sockaddr_un addr;
+		struct stat st;
+		memset(&addr, 0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+		if(strlen(spec + 5) >= sizeof(addr.sun_path)) {
+			errno = ENAMETOOLONG;
+			return -1;
 		}
-		if((p2=strchr(buf,','))==NULL) {	
-			printf("Wrong format\n");
-			
-			return;
+		strcpy(addr.sun_path, spec + 5);
+		// replace a socket left behind by an earlier run, but nothing else
+		if(stat(addr.sun_path, &st) == 0 && S_ISSOCK(st.st_mode))
+			unlink(addr.sun_path);
+		if((fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) < 0)
+			return -1;
+		if(bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, SOMAXCONN) < 0) {
+			close(fd);
+			return -1;
 		}
-		else {
-			if(p2-buf==0) {
-				printf("	PRN number Satellite # %d: not specified\n",i);
-				buf++;
-				index++;
-			}
-			else {
-				index+=(p2-buf+1);
-				strncpy(auxBuf, buf, p2 - buf);
-				auxBuf[p2 - buf] = '\0';
-				buf = p2 + 1;
-				if (checkdigit(auxBuf,0)<0) {
-				printf("PRN number Satellite must be a number");
-				return;
-			}
-			printf("	PRN number Satellite # %d: %s\n", i,auxBuf);
-			}
+		return MuxAdd(m, fd, 1, spec) != NULL ? 0 : -1;
+	}
+	if(strncmp(spec, "tcp:", 4) == 0) {
+		struct sockaddr_in addr;
+		memset(&addr, 0, sizeof(addr));
+		addr.sin_family = AF_INET;
+		if((port = TcpSourcePort(spec)) < 0) {
+			errno = EINVAL;
+			return -1;
+		}
+		addr.sin_port = htons(port);
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		if((fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) < 0)
+			return -1;
+		setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+		if(bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, SOMAXCONN) < 0) {
+			close(fd);
+			return -1;
 		}
+		return MuxAdd(m, fd, 1, spec) != NULL ? 0 : -1;
+	}
+	if(strcmp(spec, "-") == 0)
+		fd = STDIN_FILENO;
+	else if((fd = open(spec, O_RDONLY | O_NOCTTY | O_NONBLOCK | O_CLOEXEC)) < 0)
+		return -1;
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+	if(MuxAdd(m, fd, 0, spec) == NULL) {
+		if(fd != STDIN_FILENO)
+			close(fd);
+		return -1;
+	}
+	return 0;
+}
 
-		if(index>=bufSize)
-		{
-			printf("End of string");
-			
-			return;
+/**
+ * RunMultiplexed
+ * <p>
+ * This function reads many receiver streams at once on one thread, waiting for all of
+ * them with epoll and framing each with its own framer. Every sentence is tagged with
+ * the ID of its stream, and the output is flushed once per round of ready streams. The
+ * run ends when every stream has ended and there is no listening socket, or on SIGINT
+ * or SIGTERM; open streams are then flushed and closed.
+ * <p>
+ *
+ * @param  specs Sources: paths, "-", "unix:path" or "tcp:port"
+ * @param  count Number of sources
+ * @param  ctx Output stream and counters for every sentence
+ * @return 0 on success, -1 if a source could not be opened
+ */
+static int RunMultiplexed(char **specs, int count, RunContext *ctx) {
+	struct epoll_event events[MUX_MAX_EVENTS];
+	struct sigaction sa;
+	static char buf[RING_READ_SIZE];
+	Mux m;
+	int i, n, ret = 0;
+	memset(&m, 0, sizeof(m));
+	if((m.epfd = epoll_create1(EPOLL_CLOEXEC)) < 0)
+		return -1;
+	for(i=0;i<count;i++) {
+		if(MuxOpen(&m, specs[i]) < 0) {
+			fprintf(stderr, "Unable to open the source %s: %s\n", specs[i], strerror(errno));
+			ret = -1;
+			break;
 		}
-		if((p2=strchr(buf,','))==NULL) {	
-			printf("Wrong format\n");
-			
-			return;
+	}
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = MuxSignal;
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+	signal(SIGPIPE, SIG_IGN);
+	while(ret == 0 && !muxStop && (m.open > 0 || m.listeners > 0)) {
+		// regular files are always readable, so only poll while one is left
+		n = epoll_wait(m.epfd, events, MUX_MAX_EVENTS, m.nPlain > 0 ? 0 : -1);
+		if(n < 0 && errno != EINTR) {
+			ret = -1;
+			break;
 		}
-		else {
-			if(p2-buf==0) {
-				printf("	Elevation for satellite (in degrees) # %d : not specified\n",i);
-				buf++;
-				index++;
-			}
-			else {
-				index+=(p2-buf+1);
-				strncpy(auxBuf, buf, p2 - buf);
-				auxBuf[p2 - buf] = '\0';
-				buf = p2 + 1;
-				if (checkdigit(auxBuf,0)<0) {
-				printf("Elevation for satellite must be a number");
-				return;
-			}
-				int ele = atoi(auxBuf);
-				if (ele>90 || ele<0) {
-					printf("Wrong value of Elevation. elevation measurements range from 0B0 to 90B0.");
-					
-					return;
-				}
-			printf("	Elevation for satellite (in degrees) # %d : %s\n",i,auxBuf);
-			}
+		for(i=0;i<n;i++) {
+			MuxStream *s = events[i].data.ptr;
+			if(s->listener)
+				MuxAccept(&m, s);
+			else if(!MuxRead(s, buf, sizeof(buf), ctx))
+				MuxClose(&m, s, ctx);
 		}
+		for(i=m.nStreams;m.nPlain>0 && i-->0;)
+			if(m.streams[i]->plain && !MuxRead(m.streams[i], buf, sizeof(buf), ctx))
+				MuxClose(&m, m.streams[i], ctx);
+		if(ctx->out != NULL)
+			NMEASinkFlush(ctx->out);
+	}
+	while(m.nStreams > 0)
+		MuxClose(&m, m.streams[m.nStreams - 1], ctx);
+	if(m.truncated > 0 || m.dropped > 0)
+		fprintf(stderr, "Framers dropped %lu truncated sentences and %lu bytes outside sentences\n", m.truncated, m.dropped);
+	free(m.streams);
+	close(m.epfd);
+	signal(SIGINT, SIG_DFL);
+	signal(SIGTERM, SIG_DFL);
+	return ret;
+}
 
-		if(index>=bufSize)
-		{
-			printf("End of string");
-			
-			return;
-		}
-		if((p2=strchr(buf,','))==NULL) {	
-			printf("Wrong format\n");
-			
-			return;
-		}
-		else {
-			if(p2-buf==0) {
-				printf("	Azimuth for satellite (degrees from True North) # %d : not specified\n",i);
-				buf++;
-				index++;
+#endif
+
+/*
+ * Benchmarks, selected with -b. They run over the file given on the command line and
+ * report throughput on stdout.
+ */
+
+static uint64_t ScanBuffer(StructScanFn kernel, const char *data, size_t size) {
+	NMEAStructMasks m;
+	uint64_t count = 0;
+	size_t base;
+	for(base=0;base+64<=size;base+=64) {
+		kernel(data + base, &m);
+		count += __builtin_popcountll(m.comma | m.star | m.dollar | m.cr | m.lf);
+	}
+	return count;
+}
+
+/**
+ * BenchScan
+ * <p>
+ * This function measures the structural scan kernels on a mapped file, with a memchr
+ * line count as the baseline, and prints GB/s for each.
+ * <p>
+ *
+ * @param  path File to scan
+ * @return 0 on success, -1 if the file could not be mapped
+ */
+static int BenchScan(const char *path) {
+	static const struct {
+		const char *name;
+		StructScanFn kernel;
+	} kernels[] = {
+		{ "scalar", ScanScalar },
+#ifdef NMEA_HAVE_X86_SIMD
+		{ "sse2", ScanSSE2 },
+		{ "avx2", ScanAVX2 },
+#endif
+		{ "memchr", NULL }
+	};
+	NMEAMappedFile map;
+	unsigned int k;
+	if(NMEAMapFile(path, &map, MADV_SEQUENTIAL) < 0)
+		return -1;
+	if(map.size < 64) {
+		NMEAUnmapFile(&map);
+		fprintf(stderr, "%s is too small to benchmark\n", path);
+		return 0;
+	}
+	for(k=0;k<sizeof(kernels)/sizeof(kernels[0]);k++) {
+		double start, elapsed;
+		uint64_t count = 0, rounds = 0;
+#ifdef NMEA_HAVE_X86_SIMD
+		if(kernels[k].kernel == ScanAVX2 && !__builtin_cpu_supports("avx2"))
+			continue;
+#endif
+		start = NowSeconds();
+		do {
+			if(kernels[k].kernel != NULL) {
+				count = ScanBuffer(kernels[k].kernel, map.data, map.size);
 			}
 			else {
-				index+=(p2-buf+1);
-				strncpy(auxBuf, buf, p2 - buf);
-				auxBuf[p2 - buf] = '\0';
-				buf = p2 + 1;
-				if (checkdigit(auxBuf,0)<0) {
-					printf("Azimuth for satellite must be a number");
-					return;
+				const char *p = map.data, *end = map.data + map.size;
+				count = 0;
+				while((p = memchr(p, '\n', end - p)) != NULL) {
+					count++;
+					p++;
 				}
-				int azi = atoi(auxBuf);
-				if (azi>359 || azi<0) {
-					printf("Wrong value of Azimuth. Azimuth measurements range from 0 to 359.");
-					return;
-				}
-			printf("	Azimuth for satellite (degrees from True North) # %d : %s\n",i,auxBuf);
 			}
-		}
+			rounds++;
+			elapsed = NowSeconds() - start;
+		} while(elapsed < 0.5);
+		printf("scan %-8s %8.2f GB/s  %llu %s\n", kernels[k].name, map.size * (double)rounds / elapsed / 1e9,
+			(unsigned long long)count, kernels[k].kernel != NULL ? "structural characters" : "line ends");
+	}
+	NMEAUnmapFile(&map);
+	return 0;
+}
 
-		if(index>=bufSize)
-		{
-			printf("End of string");
-			
-			return;
-		}
-		if((p2=strchr(buf,','))==NULL) {	
-			printf("Wrong format\n");
-			
-			return;
-		}
-		else {
-			if(p2-buf==0) {
-				printf("	SNR for satellite # %d : not specified\n",i);
-				buf++;
-				index++;
+/* Runs every sentence of the buffer through the separate passes or the fused scan, without printing */
+static unsigned long CheckBuffer(const char *data, size_t size, int fused, unsigned long *accepted) {
+	char scratch[MAX_INPUT_LINE_LENGTH+1];
+	const char *p = data, *end = data + size;
+	unsigned long sentences = 0;
+	*accepted = 0;
+	while(p < end) {
+		const char *nl = memchr(p, '\n', end - p);
+		size_t len = (nl != NULL ? nl : end) - p;
+		NMEASentence sentence;
+		if(len <= MAX_INPUT_LINE_LENGTH) {
+			if(fused) {
+				NMEAScannedLine scan;
+				NMEAScanLine(p, len, scratch, &scan);
+				if(scan.len > 0 && scan.buf[0] == '$') {
+					sentences++;
+					if(scan.errorLoc == 0 && NMEADecodeSentence(scan.buf, scan.len, &scan.fields, scan.type, &sentence) == NMEA_OK)
+						(*accepted)++;
+				}
 			}
 			else {
-				index+=(p2-buf+1);
-				strncpy(auxBuf, buf, p2 - buf);
-				auxBuf[p2 - buf] = '\0';
-				buf = p2 + 1;
-				if (checkdigit(auxBuf,0)<0) {
-					printf("SNR for satellite must be a number");
-					return;
-				}
-				int snr = atoi(auxBuf);
-				if (snr>99 || snr<0) {
-					printf("Wrong value of SNR. SNR measurements range from 0 to 99.");
-					
-					return;
+				const char *input = SanitizeView(p, len, scratch, &len);
+				if(len > 0 && input[0] == '$') {
+					sentences++;
+					if(CheckInputExceptions(input+6, len>6 ? len-6 : 0) == 0 && NMEAParseSentence(input, len, &sentence) == NMEA_OK)
+						(*accepted)++;
 				}
-			printf("	SNR for satellite # %d : %s\n",i,auxBuf);
 			}
 		}
+		p += len + 1;
 	}
-	// Checksum
-	if(buf[0]!='*')
-		printf("Not valid GPGSV sentence format. Terminal '*' missing");
-	else
-		printf("\n**********GPGSV format string parsing complete**********\n");
-	
+	return sentences;
 }
 
 /**
- *  GPGSTparser                          
+ * BenchFused
  * <p>
- * This function is used for parsing GPGST format sentences.
- * <p> 
- * 
- * @param  buf Buffer containing the input string read from the file
- * @param  bufsize Size of the input Buffer
+ * This function compares the separate sanitize, check and tokenize passes with the fused
+ * scan of NMEAScanLine over every sentence of a mapped file, each followed by the decoder,
+ * and prints the time per sentence. On x86 the time stamp counter is reported as well.
+ * <p>
+ *
+ * @param  path File to parse
+ * @return 0 on success, -1 if the file could not be mapped
+ */
+static int BenchFused(const char *path) {
+	static const char *names[] = { "separate", "fused" };
+	NMEAMappedFile map;
+	int k;
+	if(NMEAMapFile(path, &map, MADV_SEQUENTIAL) < 0)
+		return -1;
+	for(k=0;k<2;k++) {
+		double start, elapsed;
+		unsigned long sentences, accepted, total = 0;
+#ifdef NMEA_HAVE_X86_SIMD
+		uint64_t cycles = __rdtsc();
+#endif
+		start = NowSeconds();
+		do {
+			sentences = CheckBuffer(map.data, map.size, k, &accepted);
+			total += sentences;
+			elapsed = NowSeconds() - start;
+		} while(elapsed < 0.5 && sentences > 0);
+		if(total == 0) {
+			fprintf(stderr, "%s contains no sentences\n", path);
+			break;
+		}
+		printf("fused %-8s %8.1f ns/sentence", names[k], elapsed * 1e9 / total);
+#ifdef NMEA_HAVE_X86_SIMD
+		printf(" %8.1f cycles/sentence", (double)(__rdtsc() - cycles) / total);
+#endif
+		printf("  %lu sentences %lu accepted\n", sentences, accepted);
+	}
+	NMEAUnmapFile(&map);
+	return 0;
+}
+
+/*
+ * Synthetic corpus generator, selected with -g. Sentences are emitted in epochs the way a
+ * receiver sends them: each epoch carries 'weight' sentences of every type, GSV as one
+ * cycle of that many messages, and the clock advances by 1/rate seconds per epoch. The
+ * output depends only on the options, so the same spec gives the same corpus anywhere.
+ * A GSV cycle has at most CORPUS_GSV_MAX_MESSAGES messages: every message carries four
+ * satellites and GSV_SCHEMA caps the satellites in view at 12, so a longer cycle would
+ * only exercise the error path.
  */
+#define CORPUS_GSV_MAX_MESSAGES (12/NMEA_GSV_SV_PER_MESSAGE)
 
-void GPGSTParser(char *buf, unsigned int bufSize) {
-	char auxBuf[20];
-	char* p2;
-	unsigned int index=7;
+typedef struct {
+	unsigned long count;
+	unsigned int weight[NMEA_TYPE_COUNT];
+	unsigned int rate;
+	unsigned int fraction;
+	uint64_t errorThreshold;
+	uint64_t emptyThreshold;
+	uint64_t seed;
+} CorpusSpec;
 
-	printf("\n\n**********Parsing GPGST input string**********\n\n");
-	// GST
-	buf+=7;
-	if(index>=bufSize)
-	{
-		printf("End of string");
-		
-		return;
+typedef struct {
+	const CorpusSpec *spec;
+	uint64_t rng;
+	uint32_t ms;
+	char line[MAX_INPUT_LINE_LENGTH+1];
+	size_t len;
+} CorpusGenerator;
+
+/* xorshift64*, deterministic across platforms */
+static uint64_t NextRandom(uint64_t *s) {
+	*s ^= *s >> 12;
+	*s ^= *s << 25;
+	*s ^= *s >> 27;
+	return *s * 0x2545F4914F6CDD1Dull;
+}
+
+static unsigned int RandomBelow(CorpusGenerator *g, unsigned int n) {
+	return (NextRandom(&g->rng) >> 32) % n;
+}
+
+/* True with the probability the threshold was made from, see ProbabilityThreshold */
+static int RandomChance(CorpusGenerator *g, uint64_t threshold) {
+	return (NextRandom(&g->rng) & 0xFFFFFFFFu) < threshold;
+}
+
+static uint64_t ProbabilityThreshold(double p) {
+	if(p <= 0)
+		return 0;
+	if(p >= 1)
+		return 1ull << 32;
+	return (uint64_t)(p * 4294967296.0);
+}
+
+static void Append(CorpusGenerator *g, const char *fmt, ...) {
+	va_list ap;
+	int n;
+	va_start(ap, fmt);
+	n = vsnprintf(g->line + g->len, sizeof(g->line) - g->len, fmt, ap);
+	va_end(ap);
+	if(n > 0)
+		g->len += (size_t)n < sizeof(g->line) - g->len ? (size_t)n : sizeof(g->line) - g->len - 1;
+}
+
+/* Data field followed by its ',', left empty with the configured probability */
+static void AppendField(CorpusGenerator *g, const char *fmt, ...) {
+	va_list ap;
+	int n;
+	if(!RandomChance(g, g->spec->emptyThreshold)) {
+		va_start(ap, fmt);
+		n = vsnprintf(g->line + g->len, sizeof(g->line) - g->len, fmt, ap);
+		va_end(ap);
+		if(n > 0 && (size_t)n < sizeof(g->line) - g->len)
+			g->len += n;
 	}
-	if((p2=strchr(buf,','))==NULL) {	
-		printf("Wrong format\n");
-		
+	Append(g, ",");
+}
+
+static void AppendTime(CorpusGenerator *g) {
+	static const unsigned int div[] = { 1000, 100, 10, 1 };
+	uint32_t ms = g->ms;
+	Append(g, "%02u%02u%02u", ms/3600000, ms/60000%60, ms/1000%60);
+	if(g->spec->fraction > 0)
+		Append(g, ".%0*u", (int)g->spec->fraction, ms%1000/div[g->spec->fraction]);
+	Append(g, ",");
+}
+
+/* Coordinate and hemisphere, both empty or both present */
+static void AppendCoord(CorpusGenerator *g, unsigned int degDigits, unsigned int maxDeg, char pos, char neg) {
+	if(RandomChance(g, g->spec->emptyThreshold)) {
+		Append(g, ",,");
 		return;
 	}
-	else {
-		if(p2-buf==0) {
-			printf("Fix time not specified\n");
-			buf++;
-			index++;
-		}
-		else {
-			index+=(p2-buf+1);
-			printf("Fix taken at ");
-			strncpy(auxBuf, buf, 2);
-			auxBuf[2] = '\0';
-			int hour = atoi(auxBuf);
-			if (hour>23) {
-				printf("Wrong value of time. Hour cannot be greater than 23");
-				
-				return;
+	Append(g, "%0*u%02u.%04u,%c,", (int)degDigits, RandomBelow(g, maxDeg), RandomBelow(g, 60), RandomBelow(g, 10000),
+		RandomBelow(g, 2) ? pos : neg);
+}
+
+static void GenerateSentence(CorpusGenerator *g, NMEAType type, unsigned int msg, unsigned int total) {
+	unsigned int i;
+	g->len = 0;
+	switch(type) {
+		case NMEA_TYPE_GGA:
+			Append(g, "$GPGGA,");
+			AppendTime(g);
+			AppendCoord(g, 2, 90, 'N', 'S');
+			AppendCoord(g, 3, 180, 'E', 'W');
+			AppendField(g, "%u", 1 + RandomBelow(g, 2));
+			AppendField(g, "%02u", 4 + RandomBelow(g, 9));
+			AppendField(g, "%u.%u", RandomBelow(g, 3), RandomBelow(g, 10));
+			AppendField(g, "%u.%u", RandomBelow(g, 3000), RandomBelow(g, 10));
+			Append(g, "M,");
+			AppendField(g, "%u.%u", RandomBelow(g, 60), RandomBelow(g, 10));
+			Append(g, "M,,,");
+			break;
+		case NMEA_TYPE_GSA:
+			Append(g, "$GPGSA,%c,", RandomBelow(g, 8) ? 'A' : 'M');
+			AppendField(g, "%u", 2 + RandomBelow(g, 2));
+			for(i=0;i<NMEA_GSA_MAX_PRN;i++)
+				AppendField(g, "%02u", 1 + RandomBelow(g, 32));
+			for(i=0;i<3;i++)
+				AppendField(g, "%u.%u", RandomBelow(g, 5), RandomBelow(g, 10));
+			break;
+		case NMEA_TYPE_GSV:
+			Append(g, "$GPGSV,%u,%u,", total, msg);
+			AppendField(g, "%02u", total*NMEA_GSV_SV_PER_MESSAGE);
+			for(i=0;i<NMEA_GSV_SV_PER_MESSAGE;i++) {
+				AppendField(g, "%02u", 1 + RandomBelow(g, 32));
+				AppendField(g, "%02u", RandomBelow(g, 91));
+				AppendField(g, "%03u", RandomBelow(g, 360));
+				AppendField(g, "%02u", RandomBelow(g, 60));
 			}
-			buf += 2;
-			printf("%s:",auxBuf);
-			strncpy(auxBuf, buf, 2);
-			auxBuf[2] = '\0';
-			buf += 2;
-			int min = atoi(auxBuf);
-			if (min>59) {
-				printf("Wrong value of time. Minutes cannot be greater than 59");
-				
-				return;
+			break;
+		case NMEA_TYPE_GST:
+			Append(g, "$GPGST,");
+			AppendTime(g);
+			for(i=0;i<7;i++) {
+				if(i == 3)
+					AppendField(g, "%u.%u", RandomBelow(g, 360), RandomBelow(g, 10));
+				else
+					AppendField(g, "%u.%03u", RandomBelow(g, 10), RandomBelow(g, 1000));
 			}
-			printf("%s:",auxBuf);
-			strncpy(auxBuf, buf, 2);
-			auxBuf[2] = '\0';
-			buf = p2 + 1;
-			int sec = atoi(auxBuf);
-			if (sec>59) {
-				printf("Wrong value of time. Seconds cannot be greater than 59");
-				
-				return;
+			break;
+		case NMEA_TYPE_GLL:
+			Append(g, "$GPGLL,");
+			AppendCoord(g, 2, 90, 'N', 'S');
+			AppendCoord(g, 3, 180, 'E', 'W');
+			AppendTime(g);
+			Append(g, "%c,", RandomBelow(g, 8) ? 'A' : 'V');
+			break;
+		default:
+			return;
+	}
+	Append(g, "*%02X", NMEAChecksum(g->line + 1, g->len - 1));
+	if(RandomChance(g, g->spec->errorThreshold))
+		g->line[RandomBelow(g, g->len)] = " ,.*$0AZ"[RandomBelow(g, 8)];
+}
+
+/**
+ * GenerateCorpus
+ * <p>
+ * This function writes spec->count synthetic sentences to out, one per line.
+ * <p>
+ *
+ * @param  out Stream receiving the corpus
+ * @param  spec Sentence mix, clock and error settings
+ */
+static void GenerateCorpus(FILE *out, const CorpusSpec *spec) {
+	static const NMEAType order[] = { NMEA_TYPE_GGA, NMEA_TYPE_GSA, NMEA_TYPE_GSV, NMEA_TYPE_GST, NMEA_TYPE_GLL };
+	CorpusGenerator g;
+	unsigned long n = 0;
+	unsigned int t, i;
+	memset(&g, 0, sizeof(g));
+	g.spec = spec;
+	g.rng = spec->seed != 0 ? spec->seed : 1;
+	while(n < spec->count) {
+		for(t=0;t<sizeof(order)/sizeof(order[0]) && n < spec->count;t++) {
+			unsigned int w = spec->weight[order[t]];
+			for(i=0;i<w && n < spec->count;i++,n++) {
+				GenerateSentence(&g, order[t], i+1, w);
+				fprintf(out, "%.*s\n", (int)g.len, g.line);
 			}
-			printf("%s UTC\n",auxBuf);
 		}
+		g.ms = (g.ms + 1000/spec->rate) % 86400000;
+		if(n == 0)
+			break;
 	}
-	
-	// RMS value of the pseudorange residuals
-	if(index>=bufSize)
-	{
-		printf("End of string");
-		
-		return;
-	}
-	if((p2=strchr(buf,','))==NULL) {	
-		printf("Wrong format\n");
-		
-		return;
+}
+
+/**
+ * ParseCorpusSpec
+ * <p>
+ * This function reads the comma separated name=value options of -g, for example
+ * "count=100000,gsv=3,errors=0.01,fraction=2,rate=10". Options left out keep the
+ * defaults: 100000 sentences, one of each type per epoch, 1 Hz, no fraction, no
+ * errors and no empty fields.
+ * <p>
+ *
+ * @param  options Option string, modified while it is parsed
+ * @param  spec Receives the settings
+ * @return 0 on success, -1 on an unknown option or bad value
+ */
+static int ParseCorpusSpec(char *options, CorpusSpec *spec) {
+	enum { OPT_COUNT, OPT_GGA, OPT_GSA, OPT_GSV, OPT_GST, OPT_GLL, OPT_RATE, OPT_FRACTION, OPT_ERRORS, OPT_EMPTY, OPT_SEED };
+	static char *const names[] = {
+		"count", "gga", "gsa", "gsv", "gst", "gll", "rate", "fraction", "errors", "empty", "seed", NULL
+	};
+	static const NMEAType types[] = { NMEA_TYPE_GGA, NMEA_TYPE_GSA, NMEA_TYPE_GSV, NMEA_TYPE_GST, NMEA_TYPE_GLL };
+	char *value;
+	int opt;
+	memset(spec, 0, sizeof(*spec));
+	spec->count = 100000;
+	spec->weight[NMEA_TYPE_GGA] = spec->weight[NMEA_TYPE_GSA] = spec->weight[NMEA_TYPE_GSV] = 1;
+	spec->weight[NMEA_TYPE_GST] = spec->weight[NMEA_TYPE_GLL] = 1;
+	spec->rate = 1;
+	spec->seed = 1;
+	while(*options != '\0') {
+		if((opt = getsubopt(&options, names, &value)) < 0 || value == NULL)
+			return -1;
+		switch(opt) {
+			case OPT_COUNT:
+				spec->count = strtoul(value, NULL, 10);
+				break;
+			case OPT_RATE:
+				if((spec->rate = atoi(value)) < 1 || spec->rate > 1000)
+					return -1;
+				break;
+			case OPT_FRACTION:
+				if((spec->fraction = atoi(value)) > 3)
+					return -1;
+				break;
+			case OPT_ERRORS:
+				spec->errorThreshold = ProbabilityThreshold(atof(value));
+				break;
+			case OPT_EMPTY:
+				spec->emptyThreshold = ProbabilityThreshold(atof(value));
+				break;
+			case OPT_SEED:
+				spec->seed = strtoull(value, NULL, 10);
+				break;
+			default:
+				if(atoi(value) < 0 || atoi(value) > (opt == OPT_GSV ? CORPUS_GSV_MAX_MESSAGES : 9))
+					return -1;
+				spec->weight[types[opt-OPT_GGA]] = atoi(value);
+				break;
+		}
 	}
-	else {
-		if(p2-buf==0) {
-			printf("RMS value of the pseudorange residuals not specified\n");
-			buf++;
-			index++;
+	return 0;
+}
+
+typedef int (*RunFunction)(const char *path, RunContext *ctx);
+
+/* Runs one input mode over a file repeatedly for at least half a second, without output */
+static int TimeRun(RunFunction run, const char *path, unsigned long *sentences, double *seconds, unsigned long *rounds) {
+	double start = NowSeconds();
+	*rounds = 0;
+	do {
+		RunContext ctx;
+		memset(&ctx, 0, sizeof(ctx));
+		if(run(path, &ctx) < 0)
+			return -1;
+		*sentences = ctx.sentences;
+		(*rounds)++;
+		*seconds = NowSeconds() - start;
+	} while(*seconds < 0.5);
+	return 0;
+}
+
+/**
+ * BenchThroughput
+ * <p>
+ * This function measures end-to-end parsing, without printing, through each input mode:
+ * stdio with ReadLineFromFile, the block-buffered reader and the mapped file. Every mode
+ * runs over the whole file and then over the sentences of each type on their own, split
+ * into temporary files first. One line per mode and type is printed with sentences/s,
+ * MB/s and ns/sentence.
+ * <p>
+ *
+ * @param  path Corpus to parse, for example one written by -g
+ * @return 0 on success, -1 if the file could not be read or split
+ */
+static int BenchThroughput(const char *path) {
+	static const struct {
+		const char *name;
+		RunFunction run;
+	} modes[] = {
+		{ "file", RunFile },
+		{ "buffered", RunBuffered },
+		{ "mmap", RunMapped }
+	};
+	static const char *types[] = { "all", "GGA", "GSA", "GSV", "GST", "GLL" };
+	enum { TYPE_COUNT = sizeof(types)/sizeof(types[0]) };
+	char paths[TYPE_COUNT][64];
+	off_t sizes[TYPE_COUNT];
+	FILE *split[TYPE_COUNT];
+	NMEAMappedFile map;
+	const char *p, *end;
+	unsigned int m, t;
+	int ret = 0;
+	if(NMEAMapFile(path, &map, MADV_SEQUENTIAL) < 0)
+		return -1;
+	memset(split, 0, sizeof(split));
+	for(t=1;t<TYPE_COUNT;t++) {
+		int fd;
+		snprintf(paths[t], sizeof(paths[t]), "%s/nmeabenchXXXXXX", P_tmpdir);
+		if((fd = mkstemp(paths[t])) < 0 || (split[t] = fdopen(fd, "w")) == NULL) {
+			if(fd >= 0) {
+				close(fd);
+				unlink(paths[t]);
+			}
+			ret = -1;
+			break;
 		}
-		else {
-			index+=(p2-buf+1);
-			strncpy(auxBuf, buf, p2 - buf);
-			auxBuf[p2 - buf] = '\0';
-			buf = p2 + 1;
-			if (checkdigit(auxBuf,1)<0) {
-				printf("RMS value must be a number");
-				return;
+	}
+	p = map.data;
+	end = map.data + map.size;
+	while(ret == 0 && p < end) {
+		const char *nl = memchr(p, '\n', end - p);
+		size_t len = (nl != NULL ? nl : end) - p;
+		for(t=1;t<TYPE_COUNT;t++) {
+			if(len >= 6 && p[0] == '$' && memcmp(p + 3, types[t], 3) == 0) {
+				fprintf(split[t], "%.*s\n", (int)len, p);
+				break;
 			}
-			printf("RMS value of the pseudorange residuals: %s\n", auxBuf);
 		}
+		p += len + 1;
 	}
-
-	// Error ellipse semi-major axis 1 sigma error
-	if(index>=bufSize)
-	{
-		printf("End of string");
-		
-		return;
+	NMEAUnmapFile(&map);
+	snprintf(paths[0], sizeof(paths[0]), "%s", path);
+	for(t=1;t<TYPE_COUNT;t++) {
+		if(split[t] != NULL && fclose(split[t]) != 0)
+			ret = -1;
 	}
-	if((p2=strchr(buf,','))==NULL) {	
-		printf("Wrong format\n");
-		
-		return;
+	for(t=0;t<TYPE_COUNT && ret == 0;t++) {
+		struct stat st;
+		if(stat(paths[t], &st) < 0)
+			ret = -1;
+		sizes[t] = st.st_size;
 	}
-	else {
-		if(p2-buf==0) {
-			printf("Error ellipse semi-major axis 1 sigma error not specified\n");
-			buf++;
-			index++;
-		}
-		else {
-			index+=(p2-buf+1);
-			strncpy(auxBuf, buf, p2 - buf);
-			auxBuf[p2 - buf] = '\0';
-			buf = p2 + 1;
-			if (checkdigit(auxBuf,1)<0) {
-				printf("Error ellipse semi-major axis 1 sigma error must be a number");
-				return;
+	if(ret == 0)
+		printf("%-8s %-4s %10s %12s %9s %12s\n", "mode", "type", "sentences", "sentences/s", "MB/s", "ns/sentence");
+	for(m=0;m<sizeof(modes)/sizeof(modes[0]) && ret == 0;m++) {
+		for(t=0;t<TYPE_COUNT;t++) {
+			unsigned long sentences, rounds;
+			double seconds, total;
+			if(sizes[t] == 0)
+				continue;
+			if(TimeRun(modes[m].run, paths[t], &sentences, &seconds, &rounds) < 0) {
+				ret = -1;
+				break;
 			}
-			printf("Error ellipse semi-major axis 1 sigma error: %s m\n", auxBuf);
+			total = (double)sentences * rounds;
+			printf("%-8s %-4s %10lu %12.0f %9.1f %12.1f\n", modes[m].name, types[t], sentences,
+				total / seconds, sizes[t] * (double)rounds / seconds / 1e6, total > 0 ? seconds * 1e9 / total : 0.0);
 		}
 	}
-
-	// Error ellipse semi-minor axis 1 sigma error
-	if(index>=bufSize)
-	{
-		printf("End of string");
-		
-		return;
+	for(t=1;t<TYPE_COUNT;t++) {
+		if(split[t] != NULL)
+			unlink(paths[t]);
 	}
-	if((p2=strchr(buf,','))==NULL) {	
-		printf("Wrong format\n");
-		
+	return ret;
+}
+
+/*
+ * Per-stage microbenchmarks, selected with -b stages. Hardware counters are read with
+ * perf_event_open where the kernel allows it, otherwise only the time is reported.
+ */
+
+enum {
+	COUNTER_CYCLES = 0,
+	COUNTER_INSTRUCTIONS,
+	COUNTER_BRANCH_MISSES,
+	COUNTER_L1D_MISSES,
+	COUNTER_COUNT
+};
+
+typedef struct {
+	int fd[COUNTER_COUNT];
+	int available;
+} StageCounters;
+
+#ifdef __linux__
+static int OpenCounter(uint32_t type, uint64_t config, int group) {
+	struct perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = type;
+	attr.config = config;
+	attr.disabled = group < 0;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+	return syscall(SYS_perf_event_open, &attr, 0, -1, group, 0);
+}
+#endif
+
+/* Opens the counters as one group; available stays 0 when the kernel refuses any of them */
+static void CountersOpen(StageCounters *c) {
+	int i;
+	c->available = 0;
+	for(i=0;i<COUNTER_COUNT;i++)
+		c->fd[i] = -1;
+#ifdef __linux__
+	c->fd[COUNTER_CYCLES] = OpenCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, -1);
+	if(c->fd[COUNTER_CYCLES] < 0)
 		return;
-	}
-	else {
-		if(p2-buf==0) {
-			printf("Error ellipse semi-minor axis 1 sigma error not specified\n");
-			buf++;
-			index++;
-		}
-		else {
-			index+=(p2-buf+1);
-			strncpy(auxBuf, buf, p2 - buf);
-			auxBuf[p2 - buf] = '\0';
-			buf = p2 + 1;
-			if (checkdigit(auxBuf,1)<0) {
-				printf("Error ellipse semi-minor axis 1 sigma error must be a number");
-				return;
+	c->fd[COUNTER_INSTRUCTIONS] = OpenCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, c->fd[COUNTER_CYCLES]);
+	c->fd[COUNTER_BRANCH_MISSES] = OpenCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, c->fd[COUNTER_CYCLES]);
+	c->fd[COUNTER_L1D_MISSES] = OpenCounter(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+		(PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16), c->fd[COUNTER_CYCLES]);
+	for(i=0;i<COUNTER_COUNT;i++) {
+		if(c->fd[i] < 0) {
+			for(i=0;i<COUNTER_COUNT;i++) {
+				if(c->fd[i] >= 0)
+					close(c->fd[i]);
+				c->fd[i] = -1;
 			}
-			printf("Error ellipse semi-minor axis 1 sigma error: %s m\n", auxBuf);
+			return;
 		}
 	}
+	c->available = 1;
+#endif
+}
 
-	// Error ellipse orientation
-	if(index>=bufSize)
-	{
-		printf("End of string");
-		
-		return;
-	}
-	if((p2=strchr(buf,','))==NULL) {	
-		printf("Wrong format\n");
-		
-		return;
-	}
-	else {
-		if(p2-buf==0) {
-			printf("Error ellipse orientation not specified\n");
-			buf++;
-			index++;
-		}
-		else {
-			index+=(p2-buf+1);
-			strncpy(auxBuf, buf, p2 - buf);
-			auxBuf[p2 - buf] = '\0';
-			buf = p2 + 1;
-			if (checkdigit(auxBuf,1)<0) {
-				printf("Error ellipse orientation must be a number");
-				return;
-			}
-			int azi = atoi(auxBuf);
-			if (azi>359 || azi<0) {
-				printf("Wrong value of ellipse orientation. Measurements range from 0B0 to 359B0.");
-				
-				return;
-			}
-			printf("Error ellipse orientation (degrees from true north): %s\n", auxBuf);
-		}
+static void CountersClose(StageCounters *c) {
+	int i;
+	for(i=0;i<COUNTER_COUNT;i++) {
+		if(c->fd[i] >= 0)
+			close(c->fd[i]);
 	}
+}
 
-	//Latitude 1 sigma error
-	if(index>=bufSize)
-	{
-		printf("End of string");
-		
-		return;
+static void CountersStart(StageCounters *c) {
+#ifdef __linux__
+	if(c->available) {
+		ioctl(c->fd[COUNTER_CYCLES], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+		ioctl(c->fd[COUNTER_CYCLES], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
 	}
-	if((p2=strchr(buf,','))==NULL) {	
-		printf("Wrong format\n");
-		
-		return;
+#else
+	(void)c;
+#endif
+}
+
+/* Stops the group and reads it, scaled up if the kernel multiplexed it; 0 if unavailable */
+static int CountersStop(StageCounters *c, double values[COUNTER_COUNT]) {
+#ifdef __linux__
+	uint64_t data[3+COUNTER_COUNT];
+	int i;
+	if(!c->available)
+		return 0;
+	ioctl(c->fd[COUNTER_CYCLES], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+	if(read(c->fd[COUNTER_CYCLES], data, sizeof(data)) != sizeof(data) || data[0] != COUNTER_COUNT || data[2] == 0)
+		return 0;
+	for(i=0;i<COUNTER_COUNT;i++)
+		values[i] = (double)data[3+i] * data[1] / data[2];
+	return 1;
+#else
+	(void)c;
+	(void)values;
+	return 0;
+#endif
+}
+
+/* Sentences of a corpus prepared for the stages: raw lines, sanitized copies and fields */
+typedef struct {
+	size_t count;
+	const char **raw;
+	unsigned int *rawLen;
+	char **line;
+	unsigned int *len;
+	NMEAType *type;
+	NMEAFields *fields;
+	NMEASentence result;
+	unsigned long sink;
+} StageCorpus;
+
+typedef unsigned long (*StageFunction)(StageCorpus *c);
+
+static unsigned long StageCheckdigit(StageCorpus *c) {
+	unsigned long n = 0;
+	size_t i;
+	unsigned int k;
+	for(i=0;i<c->count;i++) {
+		for(k=1;k<c->fields[i].count;k++)
+			c->sink += checkdigit(c->line[i] + c->fields[i].start[k], c->fields[i].len[k], 1);
+		n++;
 	}
-	else {
-		if(p2-buf==0) {
-			printf("Latitude 1 sigma error not specified\n");
-			buf++;
-			index++;
-		}
-		else {
-			index+=(p2-buf+1);
-			strncpy(auxBuf, buf, p2 - buf);
-			auxBuf[p2 - buf] = '\0';
-			buf = p2 + 1;
-			if (checkdigit(auxBuf,1)<0) {
-				printf("Latitude 1 sigma error must be a number");
-				return;
-			}
-			printf("Latitude 1 sigma error (m): %s\n", auxBuf);
-		}
+	return n;
+}
+
+static unsigned long StageSanitizeInput(StageCorpus *c) {
+	char buf[MAX_INPUT_LINE_LENGTH+1];
+	size_t i;
+	for(i=0;i<c->count;i++) {
+		memcpy(buf, c->raw[i], c->rawLen[i]);
+		buf[c->rawLen[i]] = '\0';
+		SanitizeInput(buf);
+		c->sink += buf[0];
 	}
+	return c->count;
+}
 
-	//Longitude 1 sigma error
-	if(index>=bufSize)
-	{
-		printf("End of string");
-		
-		return;
+static unsigned long StageSanitizeView(StageCorpus *c) {
+	char scratch[MAX_INPUT_LINE_LENGTH+1];
+	size_t i, len;
+	for(i=0;i<c->count;i++)
+		c->sink += *SanitizeView(c->raw[i], c->rawLen[i], scratch, &len) + len;
+	return c->count;
+}
+
+static unsigned long StageCheckInputExceptions(StageCorpus *c) {
+	size_t i;
+	for(i=0;i<c->count;i++)
+		c->sink += CheckInputExceptions(c->line[i] + 6, c->len[i] > 6 ? c->len[i] - 6 : 0);
+	return c->count;
+}
+
+static unsigned long StageTokenize(StageCorpus *c) {
+	NMEAFields f;
+	size_t i;
+	for(i=0;i<c->count;i++) {
+		NMEATokenize(c->line[i], c->len[i], &f);
+		c->sink += f.count;
 	}
-	if((p2=strchr(buf,','))==NULL) {	
-		printf("Wrong format\n");
-		
-		return;
+	return c->count;
+}
+
+static unsigned long StageScanLine(StageCorpus *c) {
+	char scratch[MAX_INPUT_LINE_LENGTH+1];
+	NMEAScannedLine scan;
+	size_t i;
+	for(i=0;i<c->count;i++) {
+		NMEAScanLine(c->raw[i], c->rawLen[i], scratch, &scan);
+		c->sink += scan.errorLoc + scan.fields.count;
 	}
-	else {
-		if(p2-buf==0) {
-			printf("Longitude 1 sigma error not specified\n");
-			buf++;
-			index++;
-		}
-		else {
-			index+=(p2-buf+1);
-			strncpy(auxBuf, buf, p2 - buf);
-			auxBuf[p2 - buf] = '\0';
-			buf = p2 + 1;
-			if (checkdigit(auxBuf,1)<0) {
-				printf("Longitude 1 sigma error must be a number");
-				return;
-			}
-			printf("Longitude 1 sigma error (m): %s\n", auxBuf);
+	return c->count;
+}
+
+static unsigned long StageChecksum(StageCorpus *c) {
+	size_t i;
+	for(i=0;i<c->count;i++)
+		c->sink += NMEAVerifyChecksum(c->line[i], c->len[i]);
+	return c->count;
+}
+
+/* Runs one parser over the sentences of its type */
+static unsigned long StageParser(StageCorpus *c, NMEAType type) {
+	unsigned long n = 0;
+	size_t i;
+	for(i=0;i<c->count;i++) {
+		const char *buf = c->line[i];
+		const NMEAFields *f = &c->fields[i];
+		if(c->type[i] != type)
+			continue;
+		switch(type) {
+#define STAGE_CASE(NAME, member, ...) \
+			case NMEA_TYPE_##NAME: \
+				c->sink += GP##NAME##Parser(buf, f, &c->result.u.member); \
+				break;
+			NMEA_SENTENCE_TYPES(STAGE_CASE)
+			default:
+				break;
 		}
+		n++;
 	}
+	return n;
+}
 
-	//Height 1 sigma error
-	if(index>=bufSize)
-	{
-		printf("End of string");
-		
-		return;
-	}
-	if((p2=strchr(buf,','))==NULL) {	
-		printf("Wrong format\n");
-		
-		return;
+#define STAGE_PARSER(NAME, member, ...) \
+	static unsigned long StageGP##NAME##Parser(StageCorpus *c) { \
+		return StageParser(c, NMEA_TYPE_##NAME); \
 	}
-	else {
-		if(p2-buf==0) {
-			printf("Height 1 sigma error not specified\n");
-			buf++;
-			index++;
-		}
-		else {
-			index+=(p2-buf+1);
-			strncpy(auxBuf, buf, p2 - buf);
-			auxBuf[p2 - buf] = '\0';
-			buf = p2 + 1;
-			if (checkdigit(auxBuf,1)<0) {
-				printf("Height 1 sigma error must be a number");
-				return;
+
+NMEA_SENTENCE_TYPES(STAGE_PARSER)
+
+/* Collects every line of the mapped file that sanitizes to a sentence */
+static int LoadStageCorpus(const NMEAMappedFile *map, StageCorpus *c) {
+	char scratch[MAX_INPUT_LINE_LENGTH+1];
+	const char *p = map->data, *end = map->data + map->size;
+	size_t cap = 0;
+	memset(c, 0, sizeof(*c));
+	while(p < end) {
+		const char *nl = memchr(p, '\n', end - p);
+		size_t len = (nl != NULL ? nl : end) - p, slen;
+		const char *s;
+		if(len <= MAX_INPUT_LINE_LENGTH && (s = SanitizeView(p, len, scratch, &slen), slen > 0) && s[0] == '$') {
+			if(c->count == cap) {
+				cap = cap ? 2*cap : 1024;
+				if((c->raw = realloc(c->raw, cap * sizeof(*c->raw))) == NULL ||
+						(c->rawLen = realloc(c->rawLen, cap * sizeof(*c->rawLen))) == NULL ||
+						(c->line = realloc(c->line, cap * sizeof(*c->line))) == NULL ||
+						(c->len = realloc(c->len, cap * sizeof(*c->len))) == NULL ||
+						(c->type = realloc(c->type, cap * sizeof(*c->type))) == NULL ||
+						(c->fields = realloc(c->fields, cap * sizeof(*c->fields))) == NULL)
+					return -1;
 			}
-			printf("Height 1 sigma error (m): %s\n", auxBuf);
+			if((c->line[c->count] = malloc(slen + 1)) == NULL)
+				return -1;
+			memcpy(c->line[c->count], s, slen);
+			c->line[c->count][slen] = '\0';
+			c->raw[c->count] = p;
+			c->rawLen[c->count] = len;
+			c->len[c->count] = slen;
+			NMEATokenize(c->line[c->count], slen, &c->fields[c->count]);
+			c->type[c->count] = NMEAParseType(c->line[c->count], &c->fields[c->count]);
+			c->count++;
 		}
+		p += len + 1;
 	}
+	return 0;
+}
 
-	// Checksum
-	if(buf[0]!='*')
-		printf("Not valid GPGST sentence format. Terminal '*' missing");
-	else
-		printf("\n**********GPGST format string parsing complete**********\n");
-	
+static void FreeStageCorpus(StageCorpus *c) {
+	size_t i;
+	for(i=0;i<c->count;i++)
+		free(c->line[i]);
+	free(c->raw);
+	free(c->rawLen);
+	free(c->line);
+	free(c->len);
+	free(c->type);
+	free(c->fields);
 }
 
 /**
- * ReadLineFromFile                          
+ * BenchStages
  * <p>
- * This function is used to read one line from the input file from current position of file pointer.
- * <p> 
- * 
- * @param  fp File pointer pointing to current location in file
- * @param  line Data read from file is copied into this buffer
- * @return flag specifying success or failure
+ * This function runs every parsing stage on its own over the sentences of a file and
+ * prints one CSV row per stage with the time, cycles, instructions, IPC, branch misses
+ * and L1 data cache read misses per sentence the stage handled. Counter columns are
+ * left empty when the kernel does not grant perf_event_open.
+ * <p>
+ *
+ * @param  path Corpus to parse, for example one written by -g
+ * @return 0 on success, -1 if the file could not be read
  */
-
-int ReadLineFromFile(FILE *fp, char *line){
-int i=0,inputSize=0;
-	if(feof(fp)){
-	return -1;
+static int BenchStages(const char *path) {
+	static const struct {
+		const char *name;
+		StageFunction run;
+	} stages[] = {
+		{ "checkdigit", StageCheckdigit },
+		{ "SanitizeInput", StageSanitizeInput },
+		{ "SanitizeView", StageSanitizeView },
+		{ "CheckInputExceptions", StageCheckInputExceptions },
+		{ "NMEATokenize", StageTokenize },
+		{ "NMEAScanLine", StageScanLine },
+		{ "NMEAVerifyChecksum", StageChecksum },
+#define STAGE_ENTRY(NAME, member, ...) { "GP" #NAME "Parser", StageGP##NAME##Parser },
+		NMEA_SENTENCE_TYPES(STAGE_ENTRY)
+	};
+	StageCounters counters;
+	StageCorpus corpus;
+	NMEAMappedFile map;
+	unsigned int s;
+	if(NMEAMapFile(path, &map, MADV_SEQUENTIAL) < 0)
+		return -1;
+	if(LoadStageCorpus(&map, &corpus) < 0) {
+		FreeStageCorpus(&corpus);
+		NMEAUnmapFile(&map);
+		errno = ENOMEM;
+		return -1;
 	}
-	while(!feof(fp)){
-		int ch;
-		ch = fgetc(fp);
-		if(ch==EOF && inputSize == 0){
-			return -1;
-		}
-		else if(ch==EOF || ch == '\n'){
-			inputSize++;
-			line[i]='\0'; 
-			return 0;
-		}
-		else {
-			inputSize++;
-			if(inputSize > MAX_INPUT_LINE_LENGTH)
-			return inputSize; 
-			line[i++]=ch; 
+	CountersOpen(&counters);
+	if(!counters.available)
+		fprintf(stderr, "Hardware counters unavailable (%s), reporting time only\n", strerror(errno));
+	printf("stage,sentences,ns,cycles,instructions,ipc,branch_misses,l1d_misses\n");
+	for(s=0;s<sizeof(stages)/sizeof(stages[0]);s++) {
+		double values[COUNTER_COUNT], start, elapsed;
+		unsigned long n, total = 0;
+		stages[s].run(&corpus);
+		CountersStart(&counters);
+		start = NowSeconds();
+		do {
+			n = stages[s].run(&corpus);
+			total += n;
+			elapsed = NowSeconds() - start;
+		} while(elapsed < 0.2 && n > 0);
+		if(!CountersStop(&counters, values) || total == 0) {
+			printf("%s,%lu,%.2f,,,,,\n", stages[s].name, n, total ? elapsed * 1e9 / total : 0.0);
+			continue;
 		}
+		printf("%s,%lu,%.2f,%.1f,%.1f,%.3f,%.3f,%.3f\n", stages[s].name, n, elapsed * 1e9 / total,
+			values[COUNTER_CYCLES] / total, values[COUNTER_INSTRUCTIONS] / total,
+			values[COUNTER_CYCLES] > 0 ? values[COUNTER_INSTRUCTIONS] / values[COUNTER_CYCLES] : 0.0,
+			values[COUNTER_BRANCH_MISSES] / total, values[COUNTER_L1D_MISSES] / total);
 	}
-	line[i]='\0'; 
+	CountersClose(&counters);
+	FreeStageCorpus(&corpus);
+	NMEAUnmapFile(&map);
 	return 0;
 }
 
-/**
- * SanitizeInput                         
- * <p>
- * This function removes white spaces from input string.
- * <p> 
- * 
- * @param  input Buffer containing the input string passed as input as well as processed output. 
- */
-void SanitizeInput(char *input) {
-	int i=0,j=0;
-	while(input[j] != '\0') {
-		if(isspace(input[j])){
-		//if(input[j]) {
-			j++;
-		}
- 		else {
-			input[i] = input[j];
-			i++;
-			j++;
- 		}
-	}
-	input[i]='\0';
+static void Usage(const char *prog) {
+	fprintf(stderr, "Usage: %s [-m | -s | -r slots | -p stages | -j threads | -b benchmark] [-a prefix [-n rows]] [-i interval | -t from,to] [-k] [-e timeout] [-o format] [file]\n"
+		"       %s -l [-o format] source...\n"
+		"       %s -g options > corpus\n"
+		"  file  NMEA log to parse (default message.txt)\n"
+		"  -m    map the file into memory and parse it in place\n"
+		"  -s    treat the input as a live byte stream (serial port, pipe, '-' for stdin)\n"
+		"  -r    like -s, but read on a second thread that hands the sentences over through\n"
+		"        a lock-free ring of this many slots, 0 for %d\n"
+		"  -p    like -s, but in a pipeline of threads pinned to their own cores; stages\n"
+		"        are f (frame), v (validate), d (decode) and o (output), in this order,\n"
+		"        with a comma where the next thread starts: f,v,d,o or fv,do\n"
+		"  -l    read every source given, instead of one file, at once on this thread with\n"
+		"        epoll and tag each sentence with the ID of its source; a source is a path\n"
+		"        (file, FIFO, pty, device), '-', unix:path or tcp:port to accept\n"
+		"        connections on a UNIX socket or on 127.0.0.1 (not with -a, -k or -e)\n"
+		"  -j    map the file and parse it in chunks on this many threads, 0 for one per core\n"
+		"  -b    run a benchmark over the file instead of printing it:\n"
+		"          scan   structural scan kernels in GB/s\n"
+		"          fused  separate and fused sanitize/check/tokenize passes per sentence\n"
+		"          throughput  sentences/s, MB/s and ns/sentence per input mode and type\n"
+		"          stages  CSV of time and hardware counters per sentence for every stage\n"
+		"  -a    write the decoded sentences to prefix-GGA.arrow, prefix-GSA.arrow, ... as\n"
+		"        Arrow IPC files instead of printing them (not with -j)\n"
+		"  -n    rows per Arrow record batch (default %d)\n"
+		"  -i    while parsing, write the time index file.idx with an entry every interval\n"
+		"        timed sentences, 0 for %d (not with -s, -r, -p or -j)\n"
+		"  -t    parse only the sentences timed from,to (hhmmss[.sss]), seeking with file.idx\n"
+		"        or, without one, by binary search over the file\n"
+		"  -k    report each complete GSV cycle as one sky view instead of its messages\n"
+		"        (not with -j)\n"
+		"  -e    report the GGA, GSA, GST and GLL of each epoch as one fix, or once no\n"
+		"        sentence of it came for timeout ms of log time (0 for %d; not with -j)\n"
+		"  -o    output format: text (default), csv or ndjson; csv and ndjson have one row\n"
+		"        or object per sentence decoded without error, with the Arrow columns; csv\n"
+		"        has a single header with the columns of every type, empty in the rows of\n"
+		"        types without them; with -e a FIX record stands for each epoch's GGA, GSA,\n"
+		"        GST and GLL, with -k a SKY record for each satellite of a GSV cycle\n"
+		"  -g    write a synthetic corpus to stdout; options are name=value pairs separated\n"
+		"        by commas: count, gga/gsa/gst/gll (sentences per epoch, 0-9), gsv (messages\n"
+		"        per cycle, 0-%d), rate (Hz), fraction (digits of seconds, 0-3), errors and\n"
+		"        empty (probabilities), seed\n", prog, prog, prog, NMEA_RING_SLOTS, NMEA_ARROW_BATCH_ROWS, NMEA_INDEX_INTERVAL,
+		NMEA_EPOCH_TIMEOUT, CORPUS_GSV_MAX_MESSAGES);
 }
 
-/**
- * CheckInputExceptions                         
- * <p>
- * This function checks the input string for various irregullarities in format.
- * <p> 
- * 
- * @param  input Buffer containing the input string. 
- * @return value, 0 if no error found, else location of first error.
- */
-int CheckInputExceptions(char *input){
-	int i=0;
-	int digitFound=0;
-	int starFound=0;
-	int DirectionFound=0;
-	int dotFound=0;
-	int HexDigit=0;
-	int ManualFound=0;
-	int AutoFound=0;
-	int VFound=0;
-	if(input[0] != ',')
-		return 1;
-	while(input[i] != '\0') {
-		switch(input[i]){
-			case '0':
-			case '1':
-			case '2':
-			case '3':
-			case '4':
-			case '5':
-			case '6':
-			case '7':
-			case '8':
-			case '9':
-				if((DirectionFound > 0) || ((starFound >0) && ((HexDigit+digitFound)>=2))){
-					printf("\nInvalid Input ");
-					return i;
-				}
-				digitFound++;
-				break;		 
-			case '.':
-				if(dotFound > 0){
-					printf("\nInvalid Input ");
-					return i;
-				}
-				dotFound++;
-				break;		 
-			case ',':
-				digitFound=0;
-				starFound=0;
-				DirectionFound=0;
-				dotFound=0;
-				HexDigit=0;
+int main(int argc, char **argv){
+	RunContext ctx;
+	NMEASink sink;
+	ArrowExport arrow;
+	NMEAIndexWriter index;
+	NMEAGSVAssembler sky;
+	NMEAEpochAssembler epochs;
+	char indexPath[4096];
+	const char *path = "message.txt", *range = NULL;
+	uint32_t from, to;
+	long interval = -1;
+	const char *bench = NULL;
+	char *corpus = NULL;
+	size_t slots = 0;
+	unsigned int stages[PIPELINE_STAGES], nStages = 0;
+	int mode = 0, threads = 0, format = NMEA_FORMAT_TEXT, opt, ret, i;
+	memset(&ctx, 0, sizeof(ctx));
+	memset(&arrow, 0, sizeof(arrow));
+	while((opt = getopt(argc, argv, "msj:r:p:lb:g:a:n:i:t:ke:o:")) != -1) {
+		switch(opt) {
+			case 'm':
+			case 's':
+				mode = opt;
 				break;
-
-			case '*':
-				if(starFound > 0){
-					printf("\nInvalid Input ");
-					return i;
-				}
-				starFound++;
-				digitFound=0;
-				break;		 
-			case 'A':
-				if((digitFound==0) && (HexDigit==0) && (DirectionFound==0) && (dotFound==0) && (starFound==0) && (AutoFound==0)) {
-					AutoFound++;
-					break;
-				}
-				if(starFound == 0){
-					printf("\nInvalid Input ");
-					return i;
-				}
-				if(HexDigit >=2){
-					printf("\nInvalid Input ");
-					return i;
-				}
-				HexDigit++;
-				break;		 
-			case 'B':
-			case 'C':
-			case 'D':
-				if(starFound == 0){
-					printf("\nInvalid Input ");
-					return i;
-				}
-				if(HexDigit >=2){
-					printf("\nInvalid Input ");
-					return i;
-				}
-				HexDigit++;
-				break;		 
-			case 'E':
-				if(starFound == 0){
-					if(DirectionFound>0){
-						printf("\nInvalid Input ");
-						return i;
-					}
-					else {
-						if((digitFound==0) && (HexDigit==0) && (DirectionFound==0)){
-							DirectionFound++;
-							break;
-						}
-						else {
-							printf("\nInvalid Input ");
-							return i;
-						}		
-					}
-				}
-				if(HexDigit >=2){
-					printf("\nInvalid Input ");
-					return i;
-				}
-				HexDigit++;
-				break;		 
-			case 'F':
-				if(starFound == 0){
-					printf("\nInvalid Input ");
-					return i;
-				}
-				if(HexDigit >=2){
-					printf("\nInvalid Input ");
-					return i;
-				}
-				HexDigit++;
-				break;		 
-		
-			case 'a':
-				if((digitFound==0) && (HexDigit==0) && (DirectionFound==0) && (dotFound==0) && (starFound==0) && (AutoFound==0)) {
-					AutoFound++;
-					break;
-				}
-				if(starFound == 0){
-					printf("\nInvalid Input ");
-					return i;
-				}
-				if(HexDigit >=2){
-					printf("\nInvalid Input ");
-					return i;
+			case 'j':
+				mode = opt;
+				threads = atoi(optarg);
+				break;
+			case 'r':
+				mode = opt;
+				slots = strtoul(optarg, NULL, 10);
+				break;
+			case 'l':
+				mode = opt;
+				break;
+			case 'p':
+				mode = opt;
+				if(ParsePipelineSpec(optarg, stages, &nStages) < 0) {
+					Usage(argv[0]);
+					return -1;
 				}
-				HexDigit++;
-				break;		 
+				break;
 			case 'b':
-			case 'c':
-			case 'd':
-				if(starFound == 0){
-					printf("\nInvalid Input ");
-					return i;
-				}
-				if(HexDigit >=2){
-					printf("\nInvalid Input ");
-					return i;
-				}
-				HexDigit++;
-				break;		 
+				mode = opt;
+				bench = optarg;
+				break;
+			case 'g':
+				mode = opt;
+				corpus = optarg;
+				break;
+			case 'a':
+				arrow.prefix = optarg;
+				break;
+			case 'n':
+				arrow.batchRows = strtoul(optarg, NULL, 10);
+				break;
+			case 'i':
+				interval = atol(optarg);
+				break;
+			case 't':
+				range = optarg;
+				break;
+			case 'k':
+				NMEAGSVAssemblerInit(&sky);
+				ctx.sky = &sky;
+				break;
 			case 'e':
-				if(starFound == 0){
-					if(DirectionFound>0){
-						printf("\nInvalid Input ");
-						return i;
-					}
-					else{
-						if((digitFound==0)  && (HexDigit==0) && (DirectionFound==0)){
-							DirectionFound++;
-							break;
-						}
-						else{
-							printf("\nInvalid Input ");
-							return i;
-						}		
-					}
-				}
-				if(HexDigit >=2){
-					printf("\nInvalid Input ");
-					return i;
-				}
-				HexDigit++;
-				break;		 
-			case 'f':
-				if(starFound == 0){
-					printf("\nInvalid Input ");
-					return i;
-				}
-				if(HexDigit >=2){
-					printf("\nInvalid Input ");
-					return i;
-				}
-				HexDigit++;
-				break;		 
-
-			case 'm':
-				if((digitFound==0) && (HexDigit==0) && (DirectionFound==0) && (dotFound==0) && (starFound==0)){
-					ManualFound++;
-				}
-				else{
-					printf("\nInvalid Input ");
-					return i;
-				}		
-			case 'v':
-				if((digitFound==0) && (HexDigit==0) && (DirectionFound==0) && (dotFound==0) && (starFound==0) && (AutoFound==0)&&(VFound==0)){
-					VFound++;
-					break;
-				}
-				else{
-					printf("\nInvalid Input ");
-					return i;
-				}		
-			case 'M':
-				if((digitFound==0) && (HexDigit==0) && (DirectionFound==0) && (dotFound==0) && (starFound==0)){
-					ManualFound++;
-				}
-				else{
-					printf("\nInvalid Input ");
-					return i;
-				}		
-		
-			case 'N':
-			case 'S':
-				if((digitFound==0) && (starFound==0) && (HexDigit==0) && (DirectionFound==0)){
-					DirectionFound++;
-					break;
-				}
-				else{
-					printf("\nInvalid Input ");
-					return i;
-				}		
-			case 'V':
-				if((digitFound==0) && (HexDigit==0) && (DirectionFound==0) && (dotFound==0) && (starFound==0) && (AutoFound==0)&&(VFound==0)){
-					VFound++;
-					break;
-				}
-				else{
-					printf("\nInvalid Input ");
-					return i;
-				}		
-
-			case 'W':	
-				if((digitFound==0) && (starFound==0) && (HexDigit==0) && (DirectionFound==0)){
-					DirectionFound++;
-					break;
+				NMEAEpochInit(&epochs, 0, atoi(optarg) > 0 ? atoi(optarg) : NMEA_EPOCH_TIMEOUT);
+				ctx.epochs = &epochs;
+				break;
+			case 'o':
+				if(strcmp(optarg, "csv") == 0)
+					format = NMEA_FORMAT_CSV;
+				else if(strcmp(optarg, "ndjson") == 0)
+					format = NMEA_FORMAT_NDJSON;
+				else if(strcmp(optarg, "text") == 0)
+					format = NMEA_FORMAT_TEXT;
+				else {
+					Usage(argv[0]);
+					return -1;
 				}
-				else{
-					printf("\nInvalid Input ");
-					return i;
-				}		
-		
+				break;
 			default:
-				printf("\nInvalid Input ");
-				return i;
+				Usage(argv[0]);
+				return -1;
 		}
-		i++;
 	}
-	return 0;
-}
-
-
-
-
-int main(){
-	char input[MAX_INPUT_LINE_LENGTH+1],auxBuf[10];
-	FILE *fp;
-	int retLength=0;
-	fp=fopen("message.txt","r");
-	if(fp==NULL)
-	{ 
-		printf("Unable to open the file\n");
-		return -1; 
-	}
-	while(((retLength=ReadLineFromFile(fp, input))>=0))
-	{
-		
-		if(retLength > MAX_INPUT_LINE_LENGTH){
-			printf("\nThe Input Size exceeded the max length %d",MAX_INPUT_LINE_LENGTH);
-			fclose(fp);
-			return -1; 
-		}
-		SanitizeInput(input);
-		strncpy(auxBuf, input, 6);
-		auxBuf[6]='\0';
-		if(input[0] != '$') {
-			printf("Not a valid NMEA sentence. Sentense should start with '$'");
-			fclose(fp);
+	if(optind < argc)
+		path = argv[optind];
+	if((arrow.prefix != NULL || ctx.sky != NULL || ctx.epochs != NULL) && (mode == 'j' || mode == 'l' || mode == 'b' || mode == 'g')) {
+		Usage(argv[0]);
+		return -1;
+	}
+	if(mode == 'l' && optind >= argc) {
+		Usage(argv[0]);
+		return -1;
+	}
+	for(i=optind;mode == 'l' && i<argc;i++) {
+		if(strncmp(argv[i], "tcp:", 4) == 0 && TcpSourcePort(argv[i]) < 0) {
+			fprintf(stderr, "Bad source %s: the port must be a number from 1 to 65535\n", argv[i]);
+			Usage(argv[0]);
 			return -1;
 		}
-		char* p1;
-		int errorLoc;
-		p1=strtok(auxBuf,",");
-		
-		if((errorLoc=CheckInputExceptions((input+6)))>0){
-		printf("\n%s",input);
-		printf("\nError Found at location :%d\n",(errorLoc+7));
-		}
-		else if(strcmp(p1, "$GPGGA") == 0){
-			GPGGAParser(input, strlen(input));
-		}
-		else if(strcmp(p1, "$GPGSV") == 0){
-			GPGSVParser(input, sizeof(input));
-		}
-		else if(strcmp(p1, "$GPGSA") == 0){
-			GPGSAParser(input, sizeof(input));
+	}
+	if(format != NMEA_FORMAT_TEXT && (arrow.prefix != NULL || mode == 'b' || mode == 'g')) {
+		Usage(argv[0]);
+		return -1;
+	}
+	if((interval >= 0 && (mode != 0 && mode != 'm')) || (range != NULL && (mode != 0 || interval >= 0))
+		|| (range != NULL && ParseTimeRange(range, &from, &to) < 0)) {
+		Usage(argv[0]);
+		return -1;
+	}
+	if(arrow.prefix != NULL)
+		ctx.arrow = &arrow;
+	else if(mode != 'b' && mode != 'g') {
+		if(NMEASinkInit(&sink, STDOUT_FILENO, NULL, format, 0) < 0) {
+			fprintf(stderr, "Unable to allocate the output buffer\n");
+			return -1;
 		}
-		else if(strcmp(p1, "$GPGLL") == 0){
-			GPGLLParser(input, sizeof(input));
+		ctx.out = &sink;
+		sink.sources = mode == 'l';
+	}
+	if(interval >= 0) {
+		snprintf(indexPath, sizeof(indexPath), "%s.idx", path);
+		if(NMEAIndexOpen(&index, indexPath, path, interval) < 0) {
+			printf("Unable to write the index %s: %s\n", indexPath, strerror(errno));
+			return -1;
 		}
-		else if(strcmp(p1, "$GPGST") == 0){
-			GPGSTParser(input, sizeof(input));
+		ctx.index = &index;
+	}
+	if(mode == 'j' && threads <= 0)
+		threads = sysconf(_SC_NPROCESSORS_ONLN) > 0 ? sysconf(_SC_NPROCESSORS_ONLN) : 1;
+	if(mode == 'b' && strcmp(bench, "scan") == 0)
+		ret = BenchScan(path);
+	else if(mode == 'b' && strcmp(bench, "fused") == 0)
+		ret = BenchFused(path);
+	else if(mode == 'b' && strcmp(bench, "throughput") == 0)
+		ret = BenchThroughput(path);
+	else if(mode == 'b' && strcmp(bench, "stages") == 0)
+		ret = BenchStages(path);
+	else if(mode == 'g') {
+		CorpusSpec spec;
+		if(ParseCorpusSpec(corpus, &spec) < 0) {
+			Usage(argv[0]);
+			return -1;
 		}
+		GenerateCorpus(stdout, &spec);
+		return 0;
+	}
+	else if(mode == 'b') {
+		Usage(argv[0]);
+		return -1;
+	}
+	else if(range != NULL) {
+		snprintf(indexPath, sizeof(indexPath), "%s.idx", path);
+		if(access(indexPath, R_OK) == 0)
+			ret = RunIndexed(path, from, to, &ctx);
 		else
-			printf("Format not supported");
-		printf("\n");
+			ret = RunBisect(path, from, to, &ctx);
 	}
-	fclose(fp);
+	else if(mode == 'm')
+		ret = RunMapped(path, &ctx);
+	else if(mode == 's')
+		ret = RunStream(path, &ctx);
+	else if(mode == 'r')
+		ret = RunRing(path, slots, &ctx);
+	else if(mode == 'p')
+		ret = RunPipeline(path, stages, nStages, &ctx);
+	else if(mode == 'l') {
+#ifdef __linux__
+		ret = RunMultiplexed(argv + optind, argc - optind, &ctx);
+#else
+		fprintf(stderr, "Multiplexing needs epoll, which this system does not have\n");
+		ret = -1;
+#endif
+	}
+	else if(mode == 'j')
+		ret = RunParallel(path, threads, &ctx);
+	else
+		ret = RunBuffered(path, &ctx);
+	if(ret < 0) {
+		int err = errno;
+		if(ctx.out != NULL)
+			NMEASinkClose(ctx.out);
+		// RunMultiplexed reports the source that failed itself
+		if(mode != 'l' && range != NULL)
+			printf("Unable to read the file %s or its index %s.idx: %s\n", path, path, strerror(err));
+		else if(mode != 'l')
+			printf("Unable to read the file %s: %s\n", path, strerror(err));
+		if(ctx.index != NULL)
+			NMEAIndexClose(ctx.index);
+		if(ctx.arrow != NULL)
+			ArrowExportClose(ctx.arrow);
+		return -1;
+	}
+	if(ctx.epochs != NULL)
+		NMEAEpochFinish(ctx.epochs, FixReady, &ctx);
+	if(ctx.out != NULL && NMEASinkClose(ctx.out) < 0) {
+		fprintf(stderr, "Unable to write the output: %s\n", strerror(errno));
+		return -1;
+	}
+	if(ctx.index != NULL && NMEAIndexClose(ctx.index) < 0) {
+		fprintf(stderr, "Unable to write the index %s\n", indexPath);
+		return -1;
+	}
+	if(ctx.arrow != NULL && ArrowExportClose(ctx.arrow) < 0) {
+		fprintf(stderr, "Unable to write the Arrow files %s-*.arrow\n", arrow.prefix);
+		return -1;
+	}
+	if(ctx.epochs != NULL)
+		fprintf(stderr, "Assembled %lu complete epochs, %lu incomplete ones and %lu pushed out of a full ring; %lu sentences had no open epoch\n",
+			ctx.epochs->complete, ctx.epochs->incomplete, ctx.epochs->evicted, ctx.epochs->orphans);
+	if(ctx.sky != NULL) {
+		NMEAGSVAssemblerFinish(ctx.sky);
+		fprintf(stderr, "Assembled %lu GSV cycles, discarded %lu incomplete ones and %lu messages from extra talkers\n",
+			ctx.sky->completed, ctx.sky->discarded, ctx.sky->dropped);
+	}
+	if(ctx.oversized > 0 || ctx.garbage > 0)
+		fprintf(stderr, "Skipped %lu lines longer than %d characters and %lu lines not starting with '$'\n",
+			ctx.oversized, MAX_INPUT_LINE_LENGTH, ctx.garbage);
 	return 0;
 }
-
-
@@ -0,0 +1,611 @@
+/*===============================================================================
+* NMEA parser library interface.
+*
+* Each sentence parser fills a caller-provided result structure and returns a
+* status code. Nothing is printed by the parsers; the Print* functions are an
+* optional consumer of the decoded results.
+*
+* File: NMEAparser.h
+*
+===============================================================================*/
+
+#ifndef NMEAPARSER_H
+#define NMEAPARSER_H
+
+#include<stdio.h>
+#include<stddef.h>
+#include<stdint.h>
+
+#define MAX_INPUT_LINE_LENGTH 200
+#define NMEA_READER_BLOCK_SIZE (256*1024)
+#define NMEA_PARALLEL_CHUNK_SIZE (4*1024*1024)
+#define NMEA_MAX_FIELDS 32
+#define NMEA_GSA_MAX_PRN 12
+#define NMEA_GSV_SV_PER_MESSAGE 4
+
+/**
+ * Result of parsing one sentence. Everything except NMEA_OK means the sentence
+ * was rejected; the fields decoded before the error are still reported.
+ */
+typedef enum {
+	NMEA_OK = 0,
+	NMEA_ERR_FORMAT,
+	NMEA_ERR_TIME_FORMAT,
+	NMEA_ERR_NOT_NUMBER,
+	NMEA_ERR_RANGE,
+	NMEA_ERR_DIRECTION,
+	NMEA_ERR_UNIT,
+	NMEA_ERR_INVALID_VALUE,
+	NMEA_ERR_MISSING_FIELD,
+	NMEA_ERR_NO_TERMINATOR,
+	NMEA_ERR_UNSUPPORTED,
+	NMEA_ERR_CHECKSUM,
+	NMEA_STATUS_COUNT
+} NMEAStatus;
+
+/*
+ * Supported sentence types, as X(NAME, member, a, b, c): type NMEA_TYPE_##NAME, result
+ * structure NMEA##NAME, NMEASentence member u.member and formatter letters a, b, c. The
+ * type enum, the sentence union, the parsers and printers and every dispatch on the type
+ * are expanded from this list, and the column tables from NAME##_SCHEMA in NMEAparser.c,
+ * so a new type only adds its line here, its result structure, its schema and TextNAME.
+ */
+#define NMEA_SENTENCE_TYPES(X) \
+	X(GGA, gga, 'G', 'G', 'A') \
+	X(GSA, gsa, 'G', 'S', 'A') \
+	X(GLL, gll, 'G', 'L', 'L') \
+	X(GSV, gsv, 'G', 'S', 'V') \
+	X(GST, gst, 'G', 'S', 'T')
+
+#define NMEA_TYPE_ENUM(NAME, ...) NMEA_TYPE_##NAME,
+
+typedef enum {
+	NMEA_TYPE_UNKNOWN = 0,
+	NMEA_SENTENCE_TYPES(NMEA_TYPE_ENUM)
+	NMEA_TYPE_COUNT
+} NMEAType;
+
+/**
+ * Field offsets of one sentence, filled by NMEATokenize. Field 0 is the address
+ * (e.g. "GPGGA"); star is the offset of the '*' or -1 when there is none.
+ */
+typedef struct {
+	unsigned int count;
+	int star;
+	unsigned short start[NMEA_MAX_FIELDS];
+	unsigned short len[NMEA_MAX_FIELDS];
+} NMEAFields;
+
+/**
+ * One input line after the fused scan of NMEAScanLine: the sanitized sentence (inside
+ * the line or in the caller's scratch buffer), its fields and type, and the location
+ * of its first format error or 0.
+ */
+typedef struct {
+	const char *buf;
+	unsigned int len;
+	int errorLoc;
+	NMEAType type;
+	NMEAFields fields;
+} NMEAScannedLine;
+
+/** Structural characters of a 64-byte block, bit i set when byte i matches. */
+typedef struct {
+	uint64_t comma;
+	uint64_t star;
+	uint64_t dollar;
+	uint64_t cr;
+	uint64_t lf;
+} NMEAStructMasks;
+
+/*
+ * Numbers are decoded to fixed point: latitude and longitude in 1e-7 degrees, negative
+ * to the south and west; altitudes, distances and sigmas in millimetres; DOPs in
+ * hundredths; times of day in milliseconds since midnight UTC.
+ *
+ * Every result structure carries a 'valid' bitmask with bit i set when logical
+ * field i was present, and 'fieldsRead', the number of logical fields consumed
+ * before parsing stopped. A field below fieldsRead with its bit clear was empty.
+ */
+
+enum {
+	NMEA_GGA_TIME = 1<<0,
+	NMEA_GGA_LAT = 1<<1,
+	NMEA_GGA_LON = 1<<2,
+	NMEA_GGA_QUALITY = 1<<3,
+	NMEA_GGA_SATS = 1<<4,
+	NMEA_GGA_HDOP = 1<<5,
+	NMEA_GGA_ALT = 1<<6,
+	NMEA_GGA_GEOID = 1<<7,
+	NMEA_GGA_DGPS_AGE = 1<<8,
+	NMEA_GGA_DGPS_STATION = 1<<9
+};
+
+typedef struct {
+	unsigned int valid;
+	unsigned int fieldsRead;
+	uint32_t time;
+	int32_t lat;
+	int32_t lon;
+	char latDir; /* hemisphere letters as read, so a 0 keeps its S or W */
+	char lonDir;
+	int quality;
+	int satellites;
+	int32_t hdop;
+	int32_t altitude;
+	int32_t geoidHeight;
+	int dgpsAge;
+	int dgpsStation;
+} NMEAGGA;
+
+#define NMEA_GSA_MODE (1u<<0)
+#define NMEA_GSA_FIX (1u<<1)
+#define NMEA_GSA_PRN(i) (1u<<(2+(i)))
+#define NMEA_GSA_PDOP (1u<<14)
+#define NMEA_GSA_HDOP (1u<<15)
+#define NMEA_GSA_VDOP (1u<<16)
+
+typedef struct {
+	unsigned int valid;
+	unsigned int fieldsRead;
+	char mode;
+	int fixType;
+	int prn[NMEA_GSA_MAX_PRN];
+	int32_t pdop;
+	int32_t hdop;
+	int32_t vdop;
+} NMEAGSA;
+
+enum {
+	NMEA_GLL_LAT = 1<<0,
+	NMEA_GLL_LON = 1<<1,
+	NMEA_GLL_TIME = 1<<2,
+	NMEA_GLL_STATUS = 1<<3
+};
+
+typedef struct {
+	unsigned int valid;
+	unsigned int fieldsRead;
+	int32_t lat;
+	int32_t lon;
+	char latDir; /* hemisphere letters as read, so a 0 keeps its S or W */
+	char lonDir;
+	uint32_t time;
+	char status;
+} NMEAGLL;
+
+#define NMEA_GSV_TOTAL (1u<<0)
+#define NMEA_GSV_MSGNUM (1u<<1)
+#define NMEA_GSV_INVIEW (1u<<2)
+/* k: 0 PRN, 1 elevation, 2 azimuth, 3 SNR */
+#define NMEA_GSV_SV(i,k) (1u<<(3+4*(i)+(k)))
+
+typedef struct {
+	int prn;
+	int elevation;
+	int azimuth;
+	int snr;
+} NMEASatellite;
+
+typedef struct {
+	unsigned int valid;
+	unsigned int fieldsRead;
+	int totalMessages;
+	int messageNumber;
+	int satellitesInView;
+	NMEASatellite sv[NMEA_GSV_SV_PER_MESSAGE];
+} NMEAGSV;
+
+enum {
+	NMEA_GST_TIME = 1<<0,
+	NMEA_GST_RMS = 1<<1,
+	NMEA_GST_SEMI_MAJOR = 1<<2,
+	NMEA_GST_SEMI_MINOR = 1<<3,
+	NMEA_GST_ORIENTATION = 1<<4,
+	NMEA_GST_SIGMA_LAT = 1<<5,
+	NMEA_GST_SIGMA_LON = 1<<6,
+	NMEA_GST_SIGMA_ALT = 1<<7
+};
+
+typedef struct {
+	unsigned int valid;
+	unsigned int fieldsRead;
+	uint32_t time;
+	int32_t rms;
+	int32_t semiMajor;
+	int32_t semiMinor;
+	int32_t orientation; /* hundredths of a degree */
+	int32_t sigmaLat;
+	int32_t sigmaLon;
+	int32_t sigmaAlt;
+} NMEAGST;
+
+#define NMEA_SENTENCE_MEMBER(NAME, member, ...) NMEA##NAME member;
+
+/**
+ * Any supported sentence, tagged with its type and talker ID ("GP", "GN", ...), and with
+ * the ID of the input stream it came from when several are read at once (0 otherwise).
+ */
+typedef struct {
+	NMEAType type;
+	char talker[3];
+	unsigned int source;
+	union {
+		NMEA_SENTENCE_TYPES(NMEA_SENTENCE_MEMBER)
+	} u;
+} NMEASentence;
+
+int checkdigit(const char* input, unsigned int len, int x);
+unsigned char NMEAChecksum(const char *buf, size_t len);
+NMEAStatus NMEAVerifyChecksum(const char *sentence, size_t len);
+
+void NMEAStructuralScan(const char *p, size_t len, NMEAStructMasks *m);
+void NMEATokenize(const char *buf, unsigned int len, NMEAFields *f);
+#define NMEA_PARSER_DECL(NAME, member, ...) NMEAStatus GP##NAME##Parser(const char *buf, const NMEAFields *f, NMEA##NAME *member);
+NMEA_SENTENCE_TYPES(NMEA_PARSER_DECL)
+NMEAStatus NMEADecodeSentence(const char *buf, unsigned int bufSize, const NMEAFields *fields, NMEAType type, NMEASentence *out);
+NMEAStatus NMEAParseSentence(const char *buf, unsigned int bufSize, NMEASentence *out);
+
+const char *NMEAStatusString(NMEAStatus status);
+
+#define NMEA_PRINTER_DECL(NAME, member, ...) void PrintGP##NAME(FILE *out, const char *talker, const NMEA##NAME *member, NMEAStatus status);
+NMEA_SENTENCE_TYPES(NMEA_PRINTER_DECL)
+void NMEAPrintSentence(FILE *out, const NMEASentence *s, NMEAStatus status);
+
+/**
+ * Block-buffered line reader. Input is pulled from fd with read(2) in blocks of
+ * 'size' bytes and handed out as lines pointing into 'buf'; 'offset' is the input
+ * offset of buf[0].
+ */
+typedef struct {
+	int fd;
+	char *buf;
+	uint64_t offset;
+	size_t size;
+	size_t pos;
+	size_t end;
+	int eof;
+	int skipping;
+	unsigned long lines;
+	unsigned long oversized;
+} NMEALineReader;
+
+/*
+ * Column buffers for NMEADecodeBatch. Column k of a sentence type holds the logical field
+ * with bit k of that type's valid mask (NMEA_GGA_*, NMEA_GSA_*, ...), decoded to the
+ * fixed-point units of the result structures: GGA has 10 columns, GSA 17, GLL 4, GSV 19
+ * and GST 8. Characters (GSA mode, GLL status) are stored as their code. Bit r of the
+ * validity bitmap, LSB first within each byte, is set when row r has the field. The
+ * caller owns all arrays; a column whose values pointer is NULL is not filled.
+ */
+#define NMEA_MAX_COLUMNS 19
+
+typedef struct {
+	int32_t *values;
+	uint8_t *valid;
+} NMEAColumn;
+
+typedef struct {
+	size_t capacity;
+	size_t rows;
+	NMEAColumn column[NMEA_MAX_COLUMNS];
+} NMEAColumns;
+
+/** Destinations and counters of NMEADecodeBatch; a NULL column set drops that type. */
+#define NMEA_BATCH_MEMBER(NAME, member, ...) NMEAColumns *member;
+
+typedef struct {
+	NMEA_SENTENCE_TYPES(NMEA_BATCH_MEMBER)
+	unsigned long sentences;
+	unsigned long rejected;
+	unsigned long oversized;
+} NMEABatch;
+
+/*
+ * Writer of an Arrow IPC file holding the sentences of one type, see NMEAArrowOpen.
+ * Rows are collected column by column and written as one record batch per batchRows
+ * sentences; the blocks record where each batch went for the footer.
+ */
+#define NMEA_ARROW_BATCH_ROWS 65536
+
+typedef struct {
+	uint64_t offset;
+	uint32_t metaDataLength;
+	uint64_t bodyLength;
+} NMEAArrowBlock;
+
+typedef struct {
+	FILE *fp;
+	NMEAType type;
+	unsigned int columns;
+	size_t batchRows;
+	size_t rows;
+	int32_t *values;
+	uint8_t *valid;
+	char *talker;
+	uint64_t offset;
+	NMEAArrowBlock *blocks;
+	size_t nBlocks;
+	size_t capBlocks;
+	int error;
+} NMEAArrowWriter;
+
+/*
+ * Sidecar time index of a log, see NMEAIndexOpen. The file starts with a header of
+ * NMEA_INDEX_HEADER bytes: the 8-byte magic NMEA_INDEX_MAGIC, the sampling interval and a
+ * reserved word (uint32 each), then the stamp of the log indexed, its size and the FNV-1a
+ * hash of its first NMEA_INDEX_STAMP_BLOCK bytes (uint64 each), so that an index left over
+ * from a log since rotated or rewritten is not trusted. The header is followed by one
+ * NMEAIndexEntry every 'interval' timed sentences (GGA, GLL, GST), little-endian.
+ * Entry times are milliseconds since midnight of the first day of the log: a time of day
+ * more than 12 hours earlier than the previous one counts as a midnight rollover. Each
+ * entry holds the latest time seen up to its sentence, so entry times never decrease and
+ * no sentence before an entry's offset is later than the entry's time.
+ */
+#define NMEA_INDEX_MAGIC "NMEAIDX2"
+#define NMEA_INDEX_HEADER 32
+#define NMEA_INDEX_STAMP_BLOCK 4096
+#define NMEA_INDEX_INTERVAL 1000
+#define NMEA_DAY_MS 86400000u
+
+typedef struct {
+	uint64_t time;
+	uint64_t offset;
+} NMEAIndexEntry;
+
+/** Time of day unwrapped across midnight: days counts the rollovers seen so far. */
+typedef struct {
+	uint64_t days;
+	uint32_t last;
+	int started;
+} NMEALogClock;
+
+typedef struct {
+	FILE *fp;
+	unsigned int interval;
+	unsigned long timed;
+	unsigned long entries;
+	NMEALogClock clock;
+	uint64_t latest;
+	int error;
+} NMEAIndexWriter;
+
+/*
+ * Sky view assembled from the messages of one GSV cycle, see NMEAGSVAssemblerPush.
+ * Bit k of svValid[i] is set when field k of satellite i (0 PRN, 1 elevation,
+ * 2 azimuth, 3 SNR) was given; satellites with no field at all are left out.
+ */
+#define NMEA_GSV_MAX_MESSAGES 9
+#define NMEA_SKY_MAX_SATELLITES (NMEA_GSV_MAX_MESSAGES*NMEA_GSV_SV_PER_MESSAGE)
+#define NMEA_GSV_MAX_TALKERS 8
+
+typedef struct {
+	char talker[3];
+	int messages;
+	int satellitesInView;
+	unsigned int count;
+	NMEASatellite sv[NMEA_SKY_MAX_SATELLITES];
+	uint8_t svValid[NMEA_SKY_MAX_SATELLITES];
+} NMEASkyView;
+
+/** Cycle being gathered for one talker; nextMessage is 0 when none is in progress. */
+typedef struct {
+	NMEASkyView view;
+	int nextMessage;
+} NMEAGSVCycle;
+
+/**
+ * Assembler of GSV cycles, one per talker, in fixed storage. A cycle is discarded when
+ * a message is missing, repeated or out of order, when its message count changes, or
+ * when the input ends before its last message; talkers beyond NMEA_GSV_MAX_TALKERS are
+ * counted in 'dropped'.
+ */
+typedef struct {
+	NMEAGSVCycle cycle[NMEA_GSV_MAX_TALKERS];
+	unsigned int talkers;
+	unsigned long completed;
+	unsigned long discarded;
+	unsigned long dropped;
+} NMEAGSVAssembler;
+
+/*
+ * Fix of one epoch, merged from the GGA, GSA, GST and GLL sentences that share its
+ * time, see NMEAEpochPush. 'have' tells which of them were merged (NMEA_EPOCH_*);
+ * GSA has no time and joins the epoch of the latest timed sentence. A multi-GNSS
+ * receiver sends one GSA per constellation: 'prn' collects the satellites of all of
+ * them, while 'gsa' keeps the first for the DOPs of the combined solution. 'talker'
+ * becomes "GN" once sentences of different talkers are merged.
+ */
+enum {
+	NMEA_EPOCH_GGA = 1<<0,
+	NMEA_EPOCH_GSA = 1<<1,
+	NMEA_EPOCH_GST = 1<<2,
+	NMEA_EPOCH_GLL = 1<<3,
+	NMEA_EPOCH_ALL = 0xF
+};
+
+#define NMEA_EPOCH_RING 8
+#define NMEA_FIX_MAX_PRN (4*NMEA_GSA_MAX_PRN)
+#define NMEA_EPOCH_TIMEOUT 1000
+
+typedef struct {
+	uint64_t key;
+	uint32_t time;
+	char talker[3];
+	unsigned int have;
+	int done;
+	NMEAGGA gga;
+	NMEAGSA gsa;
+	NMEAGST gst;
+	NMEAGLL gll;
+	int prn[NMEA_FIX_MAX_PRN];
+	unsigned int prns;
+} NMEAFix;
+
+/** Called by the epoch assembler for every fix it emits. */
+typedef void (*NMEAFixHandler)(void *ctx, const NMEAFix *fix);
+
+/**
+ * Assembler of epochs in a fixed ring of open fixes, oldest at 'head'. A fix is emitted
+ * as soon as it has every sentence in 'expect', or once a sentence more than 'timeout'
+ * ms of log time later arrives, or when the ring is full and its slot is needed. A fix
+ * completed by a GSA waits at 'pending' for the GSAs of other talkers that follow it.
+ */
+typedef struct {
+	NMEAFix ring[NMEA_EPOCH_RING];
+	unsigned int head;
+	unsigned int count;
+	int latest;
+	int pending;
+	unsigned int expect;
+	uint32_t timeout;
+	NMEALogClock clock;
+	unsigned long complete;
+	unsigned long incomplete;
+	unsigned long evicted;
+	unsigned long orphans;
+} NMEAEpochAssembler;
+
+/**
+ * Buffered output sink. Records are formatted straight into 'buf' and the buffer is
+ * handed to write(2) on 'fd' (fwrite on 'fp' when fd is -1) whenever it fills up.
+ * 'header' is set once the CSV header row has been written;
+ * with 'sources' set, every record carries the source ID of its sentence.
+ */
+enum {
+	NMEA_FORMAT_TEXT = 0,
+	NMEA_FORMAT_CSV,
+	NMEA_FORMAT_NDJSON
+};
+
+#define NMEA_SINK_SIZE (64*1024)
+
+typedef struct {
+	char *buf;
+	size_t size;
+	size_t len;
+	int fd;
+	FILE *fp;
+	int format;
+	int header;
+	int sources;
+	int error;
+} NMEASink;
+
+/** Called by NMEAFramerPush for every complete sentence. */
+typedef void (*NMEASentenceHandler)(void *ctx, const char *sentence, size_t len);
+
+/**
+ * Resumable framer for byte streams that arrive in arbitrary fragments. It holds
+ * the part of a sentence received so far between calls to NMEAFramerPush.
+ */
+enum {
+	NMEA_FRAMER_IDLE = 0,
+	NMEA_FRAMER_SENTENCE,
+	NMEA_FRAMER_OVERSIZED,
+	NMEA_FRAMER_CR
+};
+
+typedef struct {
+	char buf[MAX_INPUT_LINE_LENGTH+1];
+	size_t len;
+	int state;
+	unsigned long sentences;
+	unsigned long resyncs;
+	unsigned long overflows;
+	unsigned long discarded;
+} NMEAFramer;
+
+/**
+ * Lock-free single-producer/single-consumer ring of sentence slots, see NMEARingInit.
+ * Each side keeps its index, a cached copy of the other side's index and its counters
+ * on a cache line of its own, so the two threads only share a line when one of them
+ * publishes. 'tail' is published by the producer every NMEA_RING_BATCH slots, and
+ * 'head' by the consumer every NMEA_RING_BATCH slots or when it runs dry.
+ */
+#define NMEA_CACHE_LINE 64
+#define NMEA_RING_SLOTS 1024
+#define NMEA_RING_BATCH 32
+
+typedef struct {
+	uint32_t len;
+	char text[MAX_INPUT_LINE_LENGTH+1];
+} NMEARingSlot;
+
+typedef struct {
+	/* written by the producer */
+	size_t tail __attribute__((aligned(NMEA_CACHE_LINE)));
+	size_t write;
+	size_t cachedHead;
+	unsigned long fullStalls;
+	unsigned long batches;
+	/* written by the consumer */
+	size_t head __attribute__((aligned(NMEA_CACHE_LINE)));
+	size_t read;
+	size_t cachedTail;
+	unsigned long emptyStalls;
+	unsigned long samples;
+	unsigned long long occupancy;
+	size_t peak;
+	/* set up once */
+	NMEARingSlot *slots __attribute__((aligned(NMEA_CACHE_LINE)));
+	size_t size;
+	int closed;
+} NMEARing;
+
+/** Read-only mapping of a whole file, see NMEAMapFile. */
+typedef struct {
+	const char *data;
+	size_t size;
+} NMEAMappedFile;
+
+int ReadLineFromFile(FILE *fp, char *line);
+int NMEAReaderInit(NMEALineReader *r, int fd, size_t blockSize);
+int NMEAReaderNext(NMEALineReader *r, char **line, size_t *len);
+void NMEAReaderFree(NMEALineReader *r);
+void NMEAFramerInit(NMEAFramer *f);
+void NMEAFramerPush(NMEAFramer *f, const char *data, size_t len, NMEASentenceHandler handler, void *ctx);
+void NMEAFramerFinish(NMEAFramer *f, NMEASentenceHandler handler, void *ctx);
+int NMEARingInit(NMEARing *r, size_t slots);
+NMEARingSlot *NMEARingReserve(NMEARing *r);
+void NMEARingCommit(NMEARing *r);
+void NMEARingPublish(NMEARing *r);
+void NMEARingClose(NMEARing *r);
+const NMEARingSlot *NMEARingNext(NMEARing *r);
+size_t NMEARingAvailable(NMEARing *r);
+void NMEARingFree(NMEARing *r);
+int NMEAMapFile(const char *path, NMEAMappedFile *m, int advice);
+void NMEAUnmapFile(NMEAMappedFile *m);
+void SanitizeInput(char *input);
+const char *SanitizeView(const char *input, size_t len, char *scratch, size_t *outLen);
+int CheckInputExceptions(const char *input, size_t len);
+void NMEAScanLine(const char *line, size_t len, char *scratch, NMEAScannedLine *s);
+size_t NMEADecodeBatch(const char *data, size_t size, NMEABatch *batch);
+int NMEAArrowOpen(NMEAArrowWriter *w, const char *path, NMEAType type, size_t batchRows);
+int NMEAArrowAppend(NMEAArrowWriter *w, const NMEASentence *s);
+int NMEAArrowClose(NMEAArrowWriter *w);
+uint64_t NMEALogClockAdvance(NMEALogClock *c, uint32_t ms);
+int NMEASentenceTime(const NMEASentence *s, uint32_t *ms);
+int NMEAIndexOpen(NMEAIndexWriter *w, const char *path, const char *log, unsigned int interval);
+void NMEAIndexAdd(NMEAIndexWriter *w, uint32_t ms, uint64_t offset);
+int NMEAIndexClose(NMEAIndexWriter *w);
+int NMEAIndexMatches(const NMEAMappedFile *index, const char *data, size_t size);
+int NMEAIndexSeek(const NMEAMappedFile *index, uint64_t time, NMEAIndexEntry *entry);
+void NMEAGSVAssemblerInit(NMEAGSVAssembler *a);
+const NMEASkyView *NMEAGSVAssemblerPush(NMEAGSVAssembler *a, const char *talker, const NMEAGSV *gsv);
+void NMEAGSVAssemblerFinish(NMEAGSVAssembler *a);
+void NMEAPrintSkyView(FILE *out, const NMEASkyView *view);
+void NMEAEpochInit(NMEAEpochAssembler *a, unsigned int expect, uint32_t timeout);
+void NMEAEpochPush(NMEAEpochAssembler *a, const NMEASentence *s, NMEAFixHandler handler, void *ctx);
+void NMEAEpochFinish(NMEAEpochAssembler *a, NMEAFixHandler handler, void *ctx);
+void NMEAPrintFix(FILE *out, const NMEAFix *fix);
+int NMEASinkInit(NMEASink *s, int fd, FILE *fp, int format, size_t size);
+void NMEASinkWrite(NMEASink *s, const char *data, size_t len);
+void NMEASinkSentence(NMEASink *s, const NMEASentence *sentence, NMEAStatus status);
+void NMEASinkInvalid(NMEASink *s, const char *line, size_t len, int errorLoc, unsigned int source);
+void NMEASinkSkyView(NMEASink *s, const NMEASkyView *view);
+void NMEASinkFix(NMEASink *s, const NMEAFix *fix);
+int NMEASinkFlush(NMEASink *s);
+int NMEASinkClose(NMEASink *s);
+
+#endif
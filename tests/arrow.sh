@@ -0,0 +1,48 @@
+#!/bin/sh
+# Arrow export read back with pyarrow: every file of -a must hold the rows and values
+# of its type in the -o csv output of the same corpus, across several record batches.
+# Skipped without python3 and pyarrow.
+# Run from the repository root; NMEA may name an already built parser.
+set -e
+python3 -c 'import pyarrow' 2> /dev/null || {
+	echo "SKIP: arrow (no pyarrow)"
+	exit 0
+}
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+nmea=${NMEA:-$dir/nmea}
+[ -n "$NMEA" ] || cc -O2 -pthread -o "$nmea" NMEAparser.c
+
+"$nmea" -g count=3000,gsv=3,errors=0.05,empty=0.2,seed=11 > "$dir/corpus.txt"
+"$nmea" -a "$dir/out" -n 100 "$dir/corpus.txt" > /dev/null 2>&1
+"$nmea" -o csv "$dir/corpus.txt" > "$dir/corpus.csv" 2> /dev/null
+
+python3 - "$dir/out" "$dir/corpus.csv" <<'EOF'
+import csv, sys
+import pyarrow.ipc as ipc
+
+prefix, path = sys.argv[1], sys.argv[2]
+rows = {}
+with open(path, newline='') as f:
+	for row in csv.DictReader(f):
+		rows.setdefault(row['type'], []).append(row)
+
+def text(v):
+	if v is None:
+		return ''
+	if hasattr(v, 'microsecond'):
+		return '%02d:%02d:%02d.%03d' % (v.hour, v.minute, v.second, v.microsecond // 1000)
+	return str(v)
+
+for t in ('GGA', 'GSA', 'GLL', 'GSV', 'GST'):
+	reader = ipc.open_file('%s-%s.arrow' % (prefix, t))
+	table = reader.read_all()
+	expected = rows.get(t, [])
+	if reader.num_record_batches < 2 or table.num_rows != len(expected):
+		sys.exit('FAIL: arrow %s has %d rows in %d batches, csv %d' % (t, table.num_rows, reader.num_record_batches, len(expected)))
+	for i, row in enumerate(table.to_pylist()):
+		for name, v in row.items():
+			if text(v) != expected[i][name]:
+				sys.exit('FAIL: arrow %s row %d %s is %r, csv %r' % (t, i, name, text(v), expected[i][name]))
+EOF
+echo "PASS: arrow"
@@ -0,0 +1,142 @@
+#!/bin/sh
+# Columnar decoding with NMEADecodeBatch: a driver drains column sets smaller than the
+# input and resumes from the returned offset, and must get the rows, validity bits and
+# counters of a normal run over the same lines.
+# Run from the repository root; NMEA may name an already built parser.
+set -e
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+nmea=${NMEA:-$dir/nmea}
+[ -n "$NMEA" ] || cc -O2 -pthread -o "$nmea" NMEAparser.c
+
+# driver FILE CAPACITY: prints each row as its type and values, '-' for a field without
+# its validity bit, then the counters of the batches and of a normal run
+cat > "$dir/driver.c" <<'EOF'
+#define main nmea_main
+#include "NMEAparser.c"
+#undef main
+
+int main(int argc, char **argv) {
+	static NMEAColumns cols[NMEA_TYPE_COUNT];
+	NMEABatch batch;
+	RunContext ctx;
+	FILE *in;
+	char *data;
+	long size;
+	size_t off = 0, n, capacity, drained;
+	unsigned long calls = 0;
+	unsigned int t, k;
+	if(argc != 3 || (in = fopen(argv[1], "rb")) == NULL)
+		return 2;
+	fseek(in, 0, SEEK_END);
+	size = ftell(in);
+	rewind(in);
+	if((data = malloc(size)) == NULL || fread(data, 1, size, in) != (size_t)size)
+		return 2;
+	fclose(in);
+	capacity = strtoul(argv[2], NULL, 10);
+	memset(&batch, 0, sizeof(batch));
+#define COLLECT(NAME, member, ...) batch.member = &cols[NMEA_TYPE_##NAME];
+	NMEA_SENTENCE_TYPES(COLLECT)
+	for(t=NMEA_TYPE_UNKNOWN+1;t<NMEA_TYPE_COUNT;t++) {
+		cols[t].capacity = capacity;
+		for(k=0;k<columnSchemas[t].count;k++) {
+			cols[t].column[k].values = malloc(capacity * sizeof(int32_t));
+			cols[t].column[k].valid = calloc((capacity + 7) / 8, 1);
+		}
+	}
+	while(off < (size_t)size) {
+		n = NMEADecodeBatch(data + off, size - off, &batch);
+		calls++;
+		drained = 0;
+		for(t=NMEA_TYPE_UNKNOWN+1;t<NMEA_TYPE_COUNT;t++) {
+			size_t r;
+			for(r=0;r<cols[t].rows;r++) {
+				printf("%s", columnSchemas[t].name);
+				for(k=0;k<columnSchemas[t].count;k++) {
+					const NMEAColumn *c = &cols[t].column[k];
+					if(c->valid[r >> 3] >> (r & 7) & 1)
+						printf(" %ld", (long)c->values[r]);
+					else
+						printf(" -");
+				}
+				printf("\n");
+			}
+			drained += cols[t].rows;
+			cols[t].rows = 0;
+		}
+		if(n == 0 && drained == 0)
+			return 3;
+		off += n;
+	}
+	memset(&ctx, 0, sizeof(ctx));
+	if(RunMapped(argv[1], &ctx) < 0)
+		return 2;
+	fprintf(stderr, "calls %lu\n", calls);
+	fprintf(stderr, "batch %lu sentences, %lu rejected, %lu oversized\n", batch.sentences, batch.rejected, batch.oversized);
+	fprintf(stderr, "run %lu sentences, %lu rejected, %lu oversized\n", ctx.sentences, ctx.rejected, ctx.oversized);
+	return 0;
+}
+EOF
+cc -O2 -pthread -I. -o "$dir/driver" "$dir/driver.c"
+
+# Empty fields are rows with their validity bit clear
+cat > "$dir/empty.txt" <<'EOF'
+$GNGGA,120000.00,4807.0380,N,01131.0000,E,1,08,0.9,545.4,M,46.9,M,,,*55
+$GPGSA,A,3,04,05,09,12,,,,,,,,,2.5,1.3,2.1,*13
+$GNGLL,4807.0380,N,01131.0000,E,120000.00,A,*37
+EOF
+"$dir/driver" "$dir/empty.txt" 1 > "$dir/empty.out" 2> /dev/null
+cat > "$dir/expected" <<'EOF'
+GGA 43200000 481173000 115166667 1 8 90 545400 46900 - -
+GSA 65 3 4 5 9 12 - - - - - - - - 250 130 210
+GLL 481173000 115166667 43200000 65
+EOF
+cmp -s "$dir/expected" "$dir/empty.out" || {
+	echo "FAIL: batch validity"
+	diff "$dir/expected" "$dir/empty.out"
+	exit 1
+}
+
+# A corpus with bad checksums, empty fields and an oversized line
+"$nmea" -g count=2000,gsv=3,errors=0.1,empty=0.2,seed=3 > "$dir/corpus.txt"
+printf '$GPGGA,%0300d\n' 0 >> "$dir/corpus.txt"
+
+"$dir/driver" "$dir/corpus.txt" 1000000 > "$dir/whole.out" 2> "$dir/whole.err"
+"$dir/driver" "$dir/corpus.txt" 3 > "$dir/small.out" 2> "$dir/small.err"
+
+# Draining 3 rows at a time and resuming yields the same rows of each type
+for type in GGA GSA GLL GSV GST; do
+	grep "^$type " "$dir/whole.out" > "$dir/whole.$type" || true
+	grep "^$type " "$dir/small.out" > "$dir/small.$type" || true
+	if [ ! -s "$dir/whole.$type" ] || ! cmp -s "$dir/whole.$type" "$dir/small.$type"; then
+		echo "FAIL: batch $type rows with a small capacity"
+		exit 1
+	fi
+done
+if [ "$(sed -n 's/^calls //p' "$dir/whole.err")" -ne 1 ] || [ "$(sed -n 's/^calls //p' "$dir/small.err")" -le 1 ]; then
+	echo "FAIL: batch resume"
+	exit 1
+fi
+
+# The counters agree with a normal run, and some of each kind were seen
+for err in "$dir/whole.err" "$dir/small.err"; do
+	batch=$(sed -n 's/^batch //p' "$err")
+	run=$(sed -n 's/^run //p' "$err")
+	if [ "$batch" != "$run" ] || echo "$batch" | grep -q ' 0 '; then
+		echo "FAIL: batch counters: $batch, normal run $run"
+		exit 1
+	fi
+done
+
+# Rows and empty fields match the NDJSON records of a normal run
+"$nmea" -o ndjson "$dir/corpus.txt" > "$dir/corpus.json" 2> /dev/null
+for type in GGA GSA GLL GSV GST; do
+	grep "\"type\":\"$type\"" "$dir/corpus.json" > "$dir/json.$type"
+	if [ "$(wc -l < "$dir/json.$type")" -ne "$(wc -l < "$dir/whole.$type")" ] \
+		|| [ "$(grep -o null "$dir/json.$type" | wc -l)" -ne "$(tr ' ' '\n' < "$dir/whole.$type" | grep -c '^-$')" ]; then
+		echo "FAIL: batch $type rows against a normal run"
+		exit 1
+	fi
+done
+echo "PASS: batch"
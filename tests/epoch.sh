@@ -0,0 +1,53 @@
+#!/bin/sh
+# Epoch assembly of a multi-GNSS receiver: the GSAs of every constellation in an epoch
+# add their satellites to one fix, whether they come before the fix is complete or
+# complete it, and a fix merged from several talkers is reported as GN.
+# Run from the repository root; NMEA may name an already built parser.
+set -e
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+nmea=${NMEA:-$dir/nmea}
+[ -n "$NMEA" ] || cc -O2 -pthread -o "$nmea" NMEAparser.c
+
+cat > "$dir/multi.txt" <<'EOF'
+$GNGGA,120000.00,4807.0380,N,01131.0000,E,1,08,0.9,545.4,M,46.9,M,,,*55
+$GPGSA,A,3,04,05,09,12,,,,,,,,,2.5,1.3,2.1,*13
+$GLGSA,A,3,65,67,,,,,,,,,,,2.5,1.3,2.1,*06
+$GNGST,120000.00,1.000,2.000,1.500,30.0,1.100,1.200,2.300,*50
+$GNGLL,4807.0380,N,01131.0000,E,120000.00,A,*37
+$GPGGA,120001.00,4807.0390,N,01131.0010,E,1,08,0.9,545.5,M,46.9,M,,,*4B
+$GPGST,120001.00,1.000,2.000,1.500,30.0,1.100,1.200,2.300,*4F
+$GPGLL,4807.0390,N,01131.0010,E,120001.00,A,*28
+$GPGSA,A,3,04,05,09,12,,,,,,,,,2.4,1.2,2.0,*12
+$GLGSA,A,3,65,67,,,,,,,,,,,2.4,1.2,2.0,*07
+$GAGSA,A,3,11,15,,,,,,,,,,,2.4,1.2,2.0,*0C
+EOF
+
+"$nmea" -e 0 "$dir/multi.txt" > "$dir/out" 2> "$dir/err"
+grep -E 'Assembling|PRN of|PDOP' "$dir/out" > "$dir/fixes"
+cat > "$dir/expected" <<'EOF'
+**********Assembling GN epoch**********
+PRN of satellites used: 04 05 09 12 65 67
+PDOP: 2.5
+**********Assembling GN epoch**********
+PRN of satellites used: 04 05 09 12 65 67 11 15
+PDOP: 2.4
+EOF
+cmp -s "$dir/expected" "$dir/fixes" || {
+	echo "FAIL: epoch fixes"
+	diff "$dir/expected" "$dir/fixes"
+	exit 1
+}
+grep -q 'Assembled 2 complete epochs, 0 incomplete ones and 0 pushed out of a full ring; 0 sentences had no open epoch' "$dir/err" || {
+	echo "FAIL: epoch counters"
+	exit 1
+}
+
+# The same fixes as records, the PRNs of every talker in one list
+"$nmea" -e 0 -o ndjson "$dir/multi.txt" > "$dir/fixes.json" 2> /dev/null
+if [ "$(grep -c '^{"type":"FIX","talker":"GN","time":"12:00:0[01].000",' "$dir/fixes.json")" -ne 2 ] \
+	|| ! grep -q '"pdop_x100":240,.*"prns":\[4,5,9,12,65,67,11,15\]}$' "$dir/fixes.json"; then
+	echo "FAIL: epoch records"
+	exit 1
+fi
+echo "PASS: epoch"
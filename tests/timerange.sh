@@ -0,0 +1,58 @@
+#!/bin/sh
+# Time range queries across midnight on a log longer than a day: -t must return the same
+# sentences when it bisects the bare log as when it seeks with the sidecar index.
+# Run from the repository root; NMEA may name an already built parser.
+set -e
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+nmea=${NMEA:-$dir/nmea}
+[ -n "$NMEA" ] || cc -O2 -pthread -o "$nmea" NMEAparser.c
+
+# check LOG RANGE: both searches find the same 5 fixes
+check() {
+	"$nmea" -t "$2" "$dir/$1" > "$dir/bisect.out" 2>/dev/null
+	"$nmea" -i 0 "$dir/$1" > /dev/null 2>&1
+	"$nmea" -t "$2" "$dir/$1" > "$dir/indexed.out" 2>/dev/null
+	rm -f "$dir/$1.idx"
+	if [ "$(grep -c 'Fix taken at' "$dir/bisect.out")" -ne 5 ] || ! cmp -s "$dir/bisect.out" "$dir/indexed.out"; then
+		echo "FAIL: -t $2 $1"
+		exit 1
+	fi
+}
+
+# 25 hours at 1 Hz: 00:00:00 to 00:59:59 of the next day
+"$nmea" -g count=90000,gga=1,gsa=0,gsv=0,gst=0,gll=0,rate=1 > "$dir/day25.txt"
+for range in 235958,000002 003000,003004 120000,120004 005955,005959; do
+	check day25.txt $range
+done
+
+# The range crossing midnight is the last two seconds of the first day and the first three of the second
+"$nmea" -t 235958,000002 "$dir/day25.txt" 2>/dev/null | grep 'Fix taken at' > "$dir/times"
+printf 'Fix taken at %s UTC\n' 23:59:58 23:59:59 00:00:00 00:00:01 00:00:02 | cmp -s - "$dir/times" || {
+	echo "FAIL: -t 235958,000002 times"
+	exit 1
+}
+
+# From 01:00:00, so early morning ranges are on the second day, up to the end of the file
+tail -n +3601 "$dir/day25.txt" > "$dir/day24.txt"
+for range in 003000,003004 005955,005959 010000,010004; do
+	check day24.txt $range
+done
+
+# A sentence from 23:59:59 arriving after midnight is late, not a second rollover
+awk '{ print } /^\$GPGGA,000001,/ { print "$GPGST,235959,0.006,0.023,0.020,273.6,0.023,0.020,0.031,*50" }' \
+	"$dir/day24.txt" > "$dir/late.txt"
+for range in 003000,003004 005955,005959; do
+	check late.txt $range
+done
+
+# An index left over from a log since rewritten, with other line lengths, is not trusted
+"$nmea" -g count=180000,gga=1,gsa=0,gsv=0,gst=1,gll=0,rate=1 > "$dir/rotated.txt"
+"$nmea" -i 0 "$dir/rotated.txt" > /dev/null 2>&1
+cp "$dir/day25.txt" "$dir/rotated.txt"
+"$nmea" -t 120000,120004 "$dir/rotated.txt" > "$dir/rotated.out" 2> "$dir/rotated.err"
+if [ "$(grep -c 'Fix taken at' "$dir/rotated.out")" -ne 5 ] || ! grep -q 'was not written for' "$dir/rotated.err"; then
+	echo "FAIL: stale index"
+	exit 1
+fi
+echo "PASS: timerange"